@@ -0,0 +1,145 @@
+#ifndef BANKER_H
+#define BANKER_H
+
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include "resources.h"
+
+// what avoidance has cost so far, printed in the ending report
+struct banker_stats {
+    long long checks = 0;       // safety checks, one per request that fits in the available pool
+    long long cache_hits = 0;   // checks settled by walking the cached safe sequence
+    long long full_runs = 0;    // checks that had to search for a new safe sequence
+    long long unsafe = 0;       // requests held back because granting them would be unsafe
+    long long violations = 0;   // requests from a process without a claim or beyond it, refused
+    long long wall_ns = 0;      // wall time spent in safety checks
+    long long max_ns = 0;       // slowest single check
+};
+
+// banker's algorithm over declared maximum claims
+//
+// safety is proven against the claims, so every process must declare one before its first
+// request and never ask beyond it; OSS checks within_claim first and terminates a process that does
+//
+// the last safe sequence found is kept and a new request is first checked against it:
+// walking that order with the tentative grant applied is one vector compare per process,
+// and only when some process in it can no longer finish is a fresh sequence searched for
+class banker {
+    resvec total;
+    std::vector<resvec> claim;
+    std::vector<char> declared;
+    std::vector<int> safe_order; // cached safe sequence of declared pcb indices
+public:
+    banker_stats stats;
+
+    explicit banker(const resource_geometry &g) : claim(g.processes), declared(g.processes, 0) {
+        total.fill(0);
+        for (int i = 0; i < g.resources; ++i) total[i] = (res_t)g.instances[i];
+    }
+
+    // a worker announced the most it will ever hold, a newcomer holds nothing so it can go last
+    void declare(int p, const resvec &max_claim) {
+        claim[p] = max_claim;
+        if (declared[p]) return;
+        declared[p] = 1;
+        safe_order.push_back(p);
+    }
+
+    // p left the system, dropping it from a safe sequence leaves it safe
+    void retire(int p) {
+        if (!declared[p]) return;
+        declared[p] = 0;
+        safe_order.erase(std::remove(safe_order.begin(), safe_order.end(), p), safe_order.end());
+    }
+
+    // true if p has declared a claim and would still be within it with request granted
+    bool within_claim(const resource_descriptor_base &table, int p, const resvec &request) {
+        if (declared[p] && resvec_fits_within(holding(table, p, p, request), claim[p])) return true;
+        stats.violations++;
+        return false;
+    }
+
+    // true if granting request to p (which must fit in the available pool and be within p's claim)
+    // leaves the system safe
+    bool safe_to_grant(const resource_descriptor_base &table, int p, const resvec &request) {
+        auto started = std::chrono::steady_clock::now();
+        stats.checks++;
+
+        resvec work = table.available_vector();
+        resvec_subtract(work, request);
+
+        bool safe = true;
+        if (verify_cached(table, p, request, work)) {
+            stats.cache_hits++;
+        } else {
+            stats.full_runs++;
+            std::vector<int> order;
+            safe = search(table, p, request, work, order);
+            if (safe) safe_order.swap(order);
+            else stats.unsafe++;
+        }
+
+        long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started).count();
+        stats.wall_ns += ns;
+        stats.max_ns = std::max(stats.max_ns, ns);
+        return safe;
+    }
+
+private:
+    // what q holds once the tentative grant to p is applied
+    resvec holding(const resource_descriptor_base &table, int q, int p, const resvec &request) const {
+        resvec held = table.row(q);
+        if (q == p) resvec_add(held, request);
+        return held;
+    }
+
+    // walk the cached order, every process must be able to finish with what the ones before it return
+    bool verify_cached(const resource_descriptor_base &table, int p, const resvec &request, resvec work) const {
+        for (int q : safe_order) {
+            resvec held = holding(table, q, p, request);
+            resvec need = claim[q];
+            resvec_subtract(need, held);
+            if (!resvec_fits_within(need, work)) return false;
+            resvec_add(work, held);
+        }
+        return true;
+    }
+
+    // full check: bucket each process by the first class its remaining need is short of and
+    // recheck a bucket only when a finishing process returns instances of that class
+    bool search(const resource_descriptor_base &table, int p, const resvec &request, resvec work, std::vector<int> &order) const {
+        size_t n = safe_order.size();
+        std::vector<resvec> held(n), need(n);
+        std::vector<std::vector<int>> waiting_on(MAX_RESOURCES);
+        std::vector<int> ready;
+        for (size_t k = 0; k < n; ++k) {
+            held[k] = holding(table, safe_order[k], p, request);
+            need[k] = claim[safe_order[k]];
+            resvec_subtract(need[k], held[k]);
+            int short_resource = resvec_first_exceeding(need[k], work);
+            if (short_resource == -1) ready.push_back((int)k);
+            else waiting_on[short_resource].push_back((int)k);
+        }
+
+        order.clear();
+        while (!ready.empty()) {
+            int k = ready.back();
+            ready.pop_back();
+            order.push_back(safe_order[k]);
+            resvec_add(work, held[k]);
+            for (uint64_t bits = resvec_nonzero_mask(held[k]); bits; bits &= bits - 1) {
+                std::vector<int> bucket;
+                bucket.swap(waiting_on[__builtin_ctzll(bits)]);
+                for (int w : bucket) {
+                    int short_resource = resvec_first_exceeding(need[w], work);
+                    if (short_resource == -1) ready.push_back(w);
+                    else waiting_on[short_resource].push_back(w);
+                }
+            }
+        }
+        return order.size() == n;
+    }
+};
+
+#endif
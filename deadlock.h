@@ -0,0 +1,189 @@
+#ifndef DEADLOCK_H
+#define DEADLOCK_H
+
+#include <vector>
+#include <chrono>
+#include <unordered_map>
+#include "resources.h"
+
+// a process blocked in the wait queue and the vector it is waiting for
+struct blocked_process {
+    int pcb_index;
+    resvec need;
+    long long seq; // its wait queue sequence number, names this particular wait
+};
+
+// what the detector has cost so far, printed in the ending report
+struct deadlock_stats {
+    long long runs = 0;             // detection passes actually run
+    long long skipped = 0;          // periodic checks skipped because nothing new blocked
+    long long processes_examined = 0;
+    long long rechecks = 0;         // need-vs-work vector compares
+    long long rows_read = 0;        // held rows read from the resource table
+    long long rows_reused = 0;      // held rows kept from an earlier pass
+    long long deadlocks = 0;        // passes that found a deadlocked set
+    long long victims = 0;
+    long long wall_ns = 0;          // wall time spent detecting
+};
+
+// deadlock detector over the allocation matrix, available vector and pending requests
+//
+// what is kept between passes: a deadlock can only form when a request blocks, so a periodic
+// check with no new block since the last clean pass costs nothing; and a blocked worker sends
+// nothing until it is granted, so its held row cannot change while it waits. Rows are read
+// from the table once per wait and kept, along with their sum, until the wait ends; work =
+// total instances - that sum is then updated only for the waits that began or ended.
+// the reduction itself runs again every pass over the blocked processes only, since any new
+// block takes its instances out of work and can strand processes that finished before; it
+// rechecks a blocked process only when work grows in the class it was short of
+class deadlock_detector {
+    resvec total;
+    bool dirty = false;
+
+    struct held_row {
+        resvec held;
+        long long pass; // last pass the wait was still queued
+    };
+    std::unordered_map<long long, held_row> held_rows; // by wait queue sequence number
+    resvec blocked_held;                               // sum of every kept row
+    long long passes = 0;
+
+    // held row of every blocked process, from the kept rows where the wait is not new, and
+    // work = total - what they hold; rows of waits that have ended are dropped
+    resvec load_blocked(const resource_descriptor_base &table, const std::vector<blocked_process> &blocked, std::vector<resvec> &held) {
+        passes++;
+        held.resize(blocked.size());
+        for (size_t b = 0; b < blocked.size(); ++b) {
+            auto it = held_rows.find(blocked[b].seq);
+            if (it == held_rows.end()) {
+                it = held_rows.emplace(blocked[b].seq, held_row{table.row(blocked[b].pcb_index), passes}).first;
+                resvec_add(blocked_held, it->second.held);
+                stats.rows_read++;
+            } else {
+                it->second.pass = passes;
+                stats.rows_reused++;
+            }
+            held[b] = it->second.held;
+        }
+        for (auto it = held_rows.begin(); it != held_rows.end();) {
+            if (it->second.pass == passes) {
+                ++it;
+                continue;
+            }
+            resvec_subtract(blocked_held, it->second.held);
+            it = held_rows.erase(it);
+        }
+        resvec work = total;
+        resvec_subtract(work, blocked_held);
+        return work;
+    }
+public:
+    deadlock_stats stats;
+
+    explicit deadlock_detector(const resource_geometry &g) {
+        total.fill(0);
+        for (int i = 0; i < g.resources; ++i) total[i] = (res_t)g.instances[i];
+        blocked_held.fill(0);
+    }
+
+    // a request was queued, or a victim was removed and the rest must be re-examined
+    void mark_dirty() { dirty = true; }
+
+    // called at every periodic check, false if the last pass is still valid
+    bool needs_run() {
+        if (!dirty) stats.skipped++;
+        return dirty;
+    }
+
+    // pcb indices of every deadlocked process, empty if the blocked set can all finish
+    std::vector<int> detect(const resource_descriptor_base &table, const std::vector<blocked_process> &blocked) {
+        auto started = std::chrono::steady_clock::now();
+        stats.runs++;
+        stats.processes_examined += blocked.size();
+        dirty = false;
+
+        // everything not held by a blocked process will eventually come back
+        std::vector<resvec> held;
+        resvec work = load_blocked(table, blocked, held);
+
+        // bucket each blocked process by the first class it is still short of
+        std::vector<std::vector<int>> waiting_on(MAX_RESOURCES);
+        std::vector<int> ready;
+        for (size_t b = 0; b < blocked.size(); ++b) {
+            stats.rechecks++;
+            int short_resource = resvec_first_exceeding(blocked[b].need, work);
+            if (short_resource == -1) ready.push_back((int)b);
+            else waiting_on[short_resource].push_back((int)b);
+        }
+
+        // let every process that can finish return what it holds
+        size_t finished = 0;
+        while (!ready.empty()) {
+            int b = ready.back();
+            ready.pop_back();
+            finished++;
+            resvec_add(work, held[b]);
+            for (uint64_t bits = resvec_nonzero_mask(held[b]); bits; bits &= bits - 1) {
+                std::vector<int> bucket;
+                bucket.swap(waiting_on[__builtin_ctzll(bits)]);
+                for (int w : bucket) {
+                    stats.rechecks++;
+                    int short_resource = resvec_first_exceeding(blocked[w].need, work);
+                    if (short_resource == -1) ready.push_back(w);
+                    else waiting_on[short_resource].push_back(w);
+                }
+            }
+        }
+
+        std::vector<int> deadlocked;
+        if (finished < blocked.size()) {
+            for (const std::vector<int> &bucket : waiting_on) {
+                for (int w : bucket) deadlocked.push_back(blocked[w].pcb_index);
+            }
+            stats.deadlocks++;
+        }
+        stats.wall_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started).count();
+        return deadlocked;
+    }
+
+    // the same under a strict grant order (-g fifo), blocked in arrival order: nothing is granted past
+    // an older request, so once one cannot be met even by everything that will come back, it and every
+    // request queued behind it are stuck
+    std::vector<int> detect_in_order(const resource_descriptor_base &table, const std::vector<blocked_process> &blocked) {
+        auto started = std::chrono::steady_clock::now();
+        stats.runs++;
+        stats.processes_examined += blocked.size();
+        dirty = false;
+
+        std::vector<resvec> held;
+        resvec work = load_blocked(table, blocked, held);
+        size_t b = 0;
+        for (; b < blocked.size(); ++b) {
+            stats.rechecks++;
+            if (resvec_first_exceeding(blocked[b].need, work) != -1) break;
+            resvec_add(work, held[b]);
+        }
+
+        std::vector<int> deadlocked;
+        for (size_t w = b; w < blocked.size(); ++w) deadlocked.push_back(blocked[w].pcb_index);
+        if (!deadlocked.empty()) stats.deadlocks++;
+        stats.wall_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - started).count();
+        return deadlocked;
+    }
+
+    // the deadlocked process holding the most instances, freeing it unblocks the most others
+    int choose_victim(const resource_descriptor_base &table, const std::vector<int> &deadlocked) const {
+        int victim = -1;
+        int most_held = -1;
+        for (int p : deadlocked) {
+            int held = resvec_sum(table.row(p));
+            if (held > most_held) {
+                most_held = held;
+                victim = p;
+            }
+        }
+        return victim;
+    }
+};
+
+#endif
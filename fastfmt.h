@@ -0,0 +1,39 @@
+#ifndef FASTFMT_H
+#define FASTFMT_H
+
+#include <string>
+#include <cstring>
+
+// fixed-width integer/text columns appended straight to a string, for the periodic tables
+// produces the same layout as the std::setw/std::left/std::right stream code without a stream
+
+// decimal text of v ending just before end, returns where it starts
+static inline char *int_text(char *end, long long v) {
+    unsigned long long u = (v < 0) ? 0ULL - (unsigned long long)v : (unsigned long long)v;
+    do {
+        *--end = (char)('0' + u % 10);
+        u /= 10;
+    } while (u);
+    if (v < 0) *--end = '-';
+    return end;
+}
+
+// s padded with spaces to width, on the right when left aligned; never truncated, like setw
+static inline void put_field(std::string &out, const char *s, size_t n, int width, bool left) {
+    if (!left && (int)n < width) out.append(width - n, ' ');
+    out.append(s, n);
+    if (left && (int)n < width) out.append(width - n, ' ');
+}
+
+static inline void put_field(std::string &out, const char *s, int width, bool left) {
+    put_field(out, s, strlen(s), width, left);
+}
+
+static inline void put_int(std::string &out, long long v, int width, bool left) {
+    char buf[24];
+    char *end = buf + sizeof(buf);
+    char *start = int_text(end, v);
+    put_field(out, start, end - start, width, left);
+}
+
+#endif
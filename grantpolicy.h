@@ -0,0 +1,95 @@
+#ifndef GRANTPOLICY_H
+#define GRANTPOLICY_H
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "resources.h"
+#include "waitqueue.h"
+
+// order in which OSS grants queued requests once resources come back (-g)
+//
+// every pass hands the policy the waiters that may have become grantable, the policy sorts them
+// and OSS grants in that order whatever fits; a strict policy stops at the first one that does not
+// fit and keeps new arrivals behind the queue, so nothing ever overtakes an older request
+// under the other orders a new request is granted on arrival only while no waiter is up for a recheck,
+// otherwise it is held for the next pass and sorted in with them, so it never takes what the order gives
+// to a waiter first; first-fit grants whatever fits on arrival, and a release-and-reacquire is never held
+class grant_policy {
+public:
+    virtual ~grant_policy() {}
+    virtual const char* name() const = 0;
+    // sort candidates into grant order, now_sim is the simulated clock of this pass
+    virtual void order(std::vector<waiter> &candidates, long long now_sim) const = 0;
+    virtual bool strict() const { return false; }
+    // true if a request that fits may be granted the moment it arrives, without being sorted in with
+    // the waiters; receiver threads (-X) grant that way, so they need a policy that allows it
+    virtual bool grants_on_arrival() const { return false; }
+};
+
+// oldest first, anything that fits is granted even past an older request that does not
+class first_fit_policy : public grant_policy {
+public:
+    const char* name() const override { return "first-fit"; }
+    void order(std::vector<waiter> &candidates, long long now_sim) const override {} // already in arrival order
+    bool grants_on_arrival() const override { return true; }
+};
+
+// oldest first and nothing past the first request that cannot be granted
+class fifo_strict_policy : public grant_policy {
+public:
+    const char* name() const override { return "fifo-strict"; }
+    void order(std::vector<waiter> &candidates, long long now_sim) const override {}
+    bool strict() const override { return true; }
+};
+
+// fewest instances first, oldest first among equals
+class smallest_first_policy : public grant_policy {
+public:
+    const char* name() const override { return "smallest-first"; }
+    void order(std::vector<waiter> &candidates, long long now_sim) const override {
+        std::stable_sort(candidates.begin(), candidates.end(), [](const waiter &a, const waiter &b) {
+            return resvec_sum(a.need) < resvec_sum(b.need);
+        });
+    }
+};
+
+// smallest first, but every aging_ns a request waits counts as one instance less,
+// so once enough is free a large request that has waited goes ahead of the small ones
+class aging_policy : public grant_policy {
+    long long aging_ns;
+    std::string label;
+public:
+    explicit aging_policy(long long aging_ns) : aging_ns(aging_ns), label("aging (" + std::to_string(aging_ns / 1000000) + " ms per step)") {}
+    const char* name() const override { return label.c_str(); }
+    void order(std::vector<waiter> &candidates, long long now_sim) const override {
+        auto priority = [&](const waiter &w) { return (long long) resvec_sum(w.need) - (now_sim - w.arrived_sim) / aging_ns; };
+        std::stable_sort(candidates.begin(), candidates.end(), [&](const waiter &a, const waiter &b) {
+            return priority(a) < priority(b);
+        });
+    }
+};
+
+// "first-fit", "fifo", "smallest" or "aging[:ms]", nullptr if spec names none of them
+static inline grant_policy* make_grant_policy(const std::string &spec) {
+    if (spec == "first-fit" || spec == "firstfit") return new first_fit_policy();
+    if (spec == "fifo" || spec == "fifo-strict") return new fifo_strict_policy();
+    if (spec == "smallest" || spec == "smallest-first") return new smallest_first_policy();
+    if (spec.compare(0, 5, "aging") == 0) {
+        long long ms = 100;
+        if (spec.size() > 5) {
+            if (spec[5] != ':') return nullptr;
+            try {
+                size_t used = 0;
+                ms = std::stoll(spec.substr(6), &used);
+                if (used != spec.size() - 6 || ms < 1) return nullptr;
+            } catch (...) {
+                return nullptr;
+            }
+        }
+        return new aging_policy(ms * 1000000);
+    }
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,115 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <time.h>
+#include "resources.h"
+
+// log-linear buckets: values below 2^HIST_SUB_BITS are counted exactly, above that every
+// power of two is split into 2^HIST_SUB_BITS buckets, so a percentile is within ~6%
+// (bucket b >= 16 covers [2^e + k * 2^(e-4), 2^e + (k+1) * 2^(e-4)) with e = b/16 + 3, k = b%16;
+// 960 buckets reach 2^63, a percentile reports the top of its bucket capped at the max seen)
+#define HIST_SUB_BITS 4
+#define HIST_SUB (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS ((64 - HIST_SUB_BITS) * HIST_SUB)
+
+// CLOCK_MONOTONIC in nanoseconds
+static inline long long monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// histogram of non-negative nanosecond latencies, recording is a couple of bit ops and an increment
+class latency_histogram {
+    std::vector<uint64_t> buckets;
+    uint64_t total = 0;
+    long long largest = 0;
+    long double sum = 0;
+
+    static int bucket_of(long long v) {
+        if (v < HIST_SUB) return (int)v;
+        int e = 63 - __builtin_clzll((uint64_t)v);
+        return (e - HIST_SUB_BITS + 1) * HIST_SUB + (int)((v >> (e - HIST_SUB_BITS)) - HIST_SUB);
+    }
+
+    // largest value that falls in bucket b
+    static long long bucket_top(int b) {
+        if (b < HIST_SUB) return b;
+        int e = b / HIST_SUB + HIST_SUB_BITS - 1;
+        long long base = (long long)(b % HIST_SUB + HIST_SUB) << (e - HIST_SUB_BITS);
+        return base + (1LL << (e - HIST_SUB_BITS)) - 1;
+    }
+
+public:
+    latency_histogram() : buckets(HIST_BUCKETS, 0) {}
+
+    void record(long long v) {
+        if (v < 0) v = 0;
+        buckets[bucket_of(v)]++;
+        total++;
+        sum += v;
+        largest = std::max(largest, v);
+    }
+
+    // add in everything recorded in o
+    void merge(const latency_histogram &o) {
+        for (int b = 0; b < HIST_BUCKETS; ++b) buckets[b] += o.buckets[b];
+        total += o.total;
+        sum += o.sum;
+        largest = std::max(largest, o.largest);
+    }
+
+    uint64_t count() const { return total; }
+    long long max() const { return largest; }
+    long long mean() const { return total ? (long long)(sum / total) : 0; }
+
+    // value at or below which a fraction p of recorded latencies fall, 0 if nothing was recorded
+    long long percentile(double p) const {
+        if (total == 0) return 0;
+        uint64_t rank = std::max<uint64_t>(1, (uint64_t)(p * total + 0.999999));
+        uint64_t seen = 0;
+        for (int b = 0; b < HIST_BUCKETS; ++b) {
+            seen += buckets[b];
+            if (seen >= rank) return std::min(bucket_top(b), largest);
+        }
+        return largest;
+    }
+};
+
+// request -> grant latency in simulated and wall time, overall and for each resource a request asked for
+//
+// both start when OSS takes the request off its transport (or a receiver thread does), not when the
+// worker sent it, and end when OSS decides the grant, before the ack goes out: simulated latency is
+// 0 for a request granted on arrival and the simulated time spent queued otherwise; wall latency
+// is the CLOCK_MONOTONIC time in between, the handling cost for an immediate grant
+struct latency_stats {
+    latency_histogram sim_all, wall_all;
+    std::vector<latency_histogram> sim_by_resource, wall_by_resource;
+
+    explicit latency_stats(int resources) : sim_by_resource(resources), wall_by_resource(resources) {}
+
+    void merge(const latency_stats &o) {
+        sim_all.merge(o.sim_all);
+        wall_all.merge(o.wall_all);
+        for (size_t r = 0; r < sim_by_resource.size(); ++r) {
+            sim_by_resource[r].merge(o.sim_by_resource[r]);
+            wall_by_resource[r].merge(o.wall_by_resource[r]);
+        }
+    }
+
+    void record(const resvec &request, long long sim_ns, long long wall_ns) {
+        sim_all.record(sim_ns);
+        wall_all.record(wall_ns);
+        for (uint64_t bits = resvec_nonzero_mask(request); bits; bits &= bits - 1) {
+            int r = __builtin_ctzll(bits);
+            if (r >= (int)sim_by_resource.size()) break;
+            sim_by_resource[r].record(sim_ns);
+            wall_by_resource[r].record(wall_ns);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,379 @@
+#ifndef INPROC_H
+#define INPROC_H
+
+#include <vector>
+#include <deque>
+#include <queue>
+#include <random>
+#include <cstring>
+#include "resources.h"
+#include "slots.h"
+#include "simclock.h"
+#include "transport.h"
+#include "workload.h"
+
+// -w inproc: simulated workers run inside OSS instead of being forked
+//
+// each worker is a small state machine with the same policy as worker.cpp (60/40 request/release,
+// out-of-order requests release everything above first, termination at its time limit)
+// a worker runs one step when the clock reaches its deadline and again when OSS acks it,
+// so nothing ever blocks and the whole simulation stays on the OSS thread
+
+// largest process table in-process workers can use, trace records keep the slot in 16 bits
+#define MAX_INPROC_PROCESSES 32767
+
+// where an in-process worker is between steps
+#define SIM_IDLE 0          // slot unused or worker finished
+#define SIM_SLEEPING 1      // waiting for the clock to reach its deadline
+#define SIM_WAIT_REQUEST 2  // sent a request
+#define SIM_WAIT_RELEASE 3  // sent a release
+#define SIM_WAIT_MASS 4     // sent the mass release of an out-of-order request
+#define SIM_WAIT_REREQUEST 5 // sent the request that follows that mass release
+#define SIM_WAIT_EXCHANGE 6 // sent an out-of-order request as one release-and-reacquire
+
+struct sim_worker {
+    int phase = SIM_IDLE;
+    pid_t pid = -1;
+    int epoch = 0;            // bumped whenever the worker sleeps, stale heap entries carry an older one
+    std::mt19937 gen;
+    long long launch = -1;    // launch number, names its recorded workload stream
+    workload_cursor cursor;   // its stream when replaying
+    long long end_total = 0;
+    long long interval = 0;   // request/release interval
+    long long next_action = 0;
+    int latest_requested_resource_index = -1;
+    int pending_index = -1;   // resource the message in flight is about
+    int pending_amount = 0;
+    int held[MAX_RESOURCES];
+    int max_claim[MAX_RESOURCES];
+    int released[MAX_RESOURCES]; // what the mass release or exchange in flight gave back
+};
+
+// the in-process workers and the in-memory channel between them and OSS
+// OSS drives it through the transport interface like any other channel, plus launch/run_due/kill
+class inproc_pool : public transport {
+    resource_geometry geometry;
+    sim_clock *clock;
+    worker_slot *slots;
+    bool avoidance;
+    std::vector<sim_worker> workers;
+    std::deque<MessageBuffer> inbox; // messages waiting for OSS, in the order workers sent them
+    pid_t next_pid = 1;
+    workload_recorder *recorder = nullptr;
+    const workload_file *script = nullptr;
+    bool exchange = true; // out-of-order requests as one message, else mass release then request
+
+    struct wakeup {
+        long long deadline;
+        int slot;
+        int epoch;
+        bool operator>(const wakeup &o) const { return deadline > o.deadline; }
+    };
+    std::priority_queue<wakeup, std::vector<wakeup>, std::greater<wakeup>> wakeups;
+
+public:
+    inproc_pool(const resource_geometry &g, sim_clock *clock, worker_slot *slots, bool avoidance)
+        : geometry(g), clock(clock), slots(slots), avoidance(avoidance), workers(g.processes) {}
+
+    const char* name() const override { return "inproc"; }
+
+    // worker side, only the pool's own workers send and they never wait
+    bool send(int slot, MessageBuffer &msg) override {
+        inbox.push_back(msg);
+        return true;
+    }
+    bool wait_ack(int slot, MessageBuffer &msg) override { return false; }
+
+    int poll(MessageBuffer &msg) override {
+        if (inbox.empty()) return 0;
+        msg = inbox.front();
+        inbox.pop_front();
+        return 1;
+    }
+
+    // the worker carries on from where it sent its last message
+    bool ack(int slot, pid_t pid) override {
+        if (slot < 0 || slot >= (int)workers.size() || workers[slot].pid != pid) return false;
+        acked(slot);
+        return true;
+    }
+
+    void remove() override {}
+
+    // record every worker's choices with recorder, or replay them from script instead of drawing them
+    void use_workload(workload_recorder *r, const workload_file *s) {
+        recorder = r;
+        script = s;
+    }
+
+    // with split set, out-of-order requests take a mass release and a second request as in oss -x
+    void split_reacquire(bool split) { exchange = !split; }
+
+    // start a worker in slot with time_limit_ns to live, returns its simulated pid
+    // draws happen in the same order as in worker.cpp, so a seed gives the same workload either way
+    pid_t launch(int slot, long long time_limit_ns, uint64_t seed, long long launch_number) {
+        sim_worker &w = workers[slot];
+        w.pid = next_pid++;
+        w.gen.seed(seed);
+        w.launch = launch_number;
+        if (script) w.cursor.start(*script, launch_number);
+        w.latest_requested_resource_index = -1;
+        memset(w.held, 0, sizeof(w.held));
+        long long start_total = clock->now();
+        w.end_total = start_total + time_limit_ns;
+
+        for (int i = 0; i < MAX_RESOURCES; ++i) w.max_claim[i] = (i < geometry.resources) ? geometry.instances[i] : 0;
+        if (avoidance) {
+            // random claim, at least one instance of something, declared before any request and never acked
+            if (script) {
+                for (int i = 0; i < geometry.resources; ++i) {
+                    const workload_op *o = w.cursor.take(WL_CLAIM);
+                    w.max_claim[i] = o ? o->value : 0;
+                }
+            } else {
+                int claimed = 0;
+                for (int i = 0; i < geometry.resources; ++i) {
+                    std::uniform_int_distribution<> claim_dis(0, geometry.instances[i]);
+                    w.max_claim[i] = claim_dis(w.gen);
+                    claimed += w.max_claim[i];
+                }
+                if (claimed == 0) {
+                    std::uniform_int_distribution<> class_dis(0, geometry.resources - 1);
+                    w.max_claim[class_dis(w.gen)] = 1;
+                }
+                for (int i = 0; i < geometry.resources; ++i) record(w, WL_CLAIM, i, w.max_claim[i]);
+            }
+            MessageBuffer msg = message(w, 1);
+            msg.declare_claim = 1;
+            for (int i = 0; i < geometry.resources; ++i) msg.resource_request[i] = w.max_claim[i];
+            send(slot, msg);
+        }
+
+        if (script) {
+            const workload_op *o = w.cursor.take(WL_START);
+            w.interval = o ? o->value : 100000000;
+        } else {
+            std::uniform_int_distribution<> dis(1, 100000000); // between 0 and 100 milliseconds, never zero
+            w.interval = dis(w.gen);
+            record(w, WL_START, 0, w.interval);
+        }
+        w.next_action = start_total + w.cursor.gap(w.interval);
+        sleep(slot);
+        return w.pid;
+    }
+
+    // OSS terminated the worker, it is blocked so nothing of it is in flight
+    void kill(int slot) {
+        workers[slot].phase = SIM_IDLE;
+        workers[slot].epoch++;
+    }
+
+    // step every sleeping worker whose deadline the clock has reached
+    void run_due(long long now) {
+        while (!wakeups.empty() && wakeups.top().deadline <= now) {
+            wakeup wk = wakeups.top();
+            wakeups.pop();
+            sim_worker &w = workers[wk.slot];
+            if (w.phase != SIM_SLEEPING || w.epoch != wk.epoch) continue;
+            step(wk.slot, now);
+        }
+    }
+
+    // true if a worker is acting at this instant: a message is waiting or a deadline has come
+    bool due(long long now) {
+        long long next = next_deadline();
+        return !inbox.empty() || (next != -1 && next <= now);
+    }
+
+    // earliest deadline of a sleeping worker, -1 if none is sleeping
+    long long next_deadline() {
+        while (!wakeups.empty()) {
+            const wakeup &wk = wakeups.top();
+            if (workers[wk.slot].phase == SIM_SLEEPING && workers[wk.slot].epoch == wk.epoch) return wk.deadline;
+            wakeups.pop();
+        }
+        return -1;
+    }
+
+private:
+    void record(const sim_worker &w, int op, int resource, long long value) {
+        if (!recorder) return;
+        recorder->start(w.launch);
+        recorder->append(op, resource, value);
+    }
+
+    MessageBuffer message(const sim_worker &w, int request_or_release) {
+        MessageBuffer msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.mtype = getpid();
+        msg.pid = w.pid;
+        msg.process_running = 1;
+        msg.request_or_release = request_or_release;
+        return msg;
+    }
+
+    // sleep until the next action or termination, whichever comes first
+    void sleep(int slot) {
+        sim_worker &w = workers[slot];
+        w.phase = SIM_SLEEPING;
+        w.epoch++;
+        long long deadline = std::min(w.next_action, w.end_total);
+        slots[slot].deadline = deadline;
+        slots[slot].state = SLOT_SLEEPING;
+        wakeups.push({deadline, slot, w.epoch});
+    }
+
+    void send_waiting(int slot, MessageBuffer &msg, int phase) {
+        workers[slot].phase = phase;
+        slots[slot].state = SLOT_BUSY;
+        send(slot, msg);
+    }
+
+    void update_latest(sim_worker &w) {
+        w.latest_requested_resource_index = -1;
+        for (int i = geometry.resources - 1; i >= 0; --i) {
+            if (w.held[i] > 0) {
+                w.latest_requested_resource_index = i;
+                break;
+            }
+        }
+    }
+
+    // the worker.cpp main loop body for one wake-up
+    void step(int slot, long long now) {
+        sim_worker &w = workers[slot];
+        if (now >= w.end_total) {
+            MessageBuffer msg = message(w, 0);
+            msg.process_running = 0;
+            w.phase = SIM_IDLE;
+            slots[slot].state = SLOT_BUSY;
+            send(slot, msg);
+            return;
+        }
+        if (now < w.next_action) {
+            sleep(slot);
+            return;
+        }
+        bool holding_max = true;
+        for (int i = 0; i < geometry.resources; i++) {
+            if (w.held[i] < w.max_claim[i]) holding_max = false;
+        }
+        if (holding_max && !script) {
+            record(w, WL_IDLE, 0, 0);
+            w.next_action = now + w.cursor.gap(w.interval);
+            sleep(slot);
+            return;
+        }
+        // 60% request, 40% release, or the next recorded choice when replaying
+        int action;
+        int resource_index = 0;
+        int amount = 0;
+        std::uniform_int_distribution<> action_dis(1, 100);
+        std::uniform_int_distribution<> class_dis(0, geometry.resources - 1);
+        if (script) {
+            const workload_op *o = w.cursor.take_action();
+            if (o == nullptr) {
+                // recorded stream is over, sit out the rest of the time limit
+                w.next_action = w.end_total;
+                sleep(slot);
+                return;
+            }
+            action = o->op;
+            resource_index = o->resource;
+            amount = o->value;
+            if (action == WL_TERMINATE) {
+                w.end_total = now;
+                step(slot, now);
+                return;
+            }
+            workload_fit(action, resource_index, amount, w.held, w.max_claim, geometry.resources);
+        } else if (action_dis(w.gen) <= 60) {
+            action = WL_REQUEST;
+            do resource_index = class_dis(w.gen); while (w.held[resource_index] >= w.max_claim[resource_index]);
+            std::uniform_int_distribution<> amount_dis(1, w.max_claim[resource_index] - w.held[resource_index]);
+            amount = amount_dis(w.gen);
+        } else if (w.latest_requested_resource_index == -1) {
+            action = WL_IDLE;
+        } else {
+            action = WL_RELEASE;
+            do resource_index = class_dis(w.gen); while (w.held[resource_index] == 0);
+            std::uniform_int_distribution<> amount_dis(1, w.held[resource_index]);
+            amount = amount_dis(w.gen);
+        }
+        record(w, action, resource_index, amount);
+
+        if (action == WL_IDLE) {
+            w.next_action = now + w.cursor.gap(w.interval);
+            sleep(slot);
+            return;
+        }
+        w.pending_index = resource_index;
+        w.pending_amount = amount;
+        if (action == WL_REQUEST) {
+            if (resource_index <= w.latest_requested_resource_index) {
+                // out of order, release everything from resource_index up first
+                MessageBuffer msg = message(w, exchange ? 1 : 0);
+                memset(w.released, 0, sizeof(w.released));
+                for (int i = resource_index; i < geometry.resources; i++) {
+                    w.released[i] = w.held[i];
+                    msg.resource_release[i] = w.held[i];
+                    w.held[i] = 0;
+                }
+                if (exchange) {
+                    // and request it back with the new amount in the same message
+                    msg.exchange = 1;
+                    for (int i = 0; i < geometry.resources; ++i) msg.resource_request[i] = w.released[i];
+                    msg.resource_request[resource_index] += w.pending_amount;
+                    send_waiting(slot, msg, SIM_WAIT_EXCHANGE);
+                    return;
+                }
+                msg.mass_release = 1;
+                send_waiting(slot, msg, SIM_WAIT_MASS);
+                return;
+            }
+            MessageBuffer msg = message(w, 1);
+            msg.resource_request[resource_index] = w.pending_amount;
+            send_waiting(slot, msg, SIM_WAIT_REQUEST);
+        } else {
+            MessageBuffer msg = message(w, 0);
+            msg.resource_release[resource_index] = w.pending_amount;
+            send_waiting(slot, msg, SIM_WAIT_RELEASE);
+        }
+    }
+
+    // OSS answered the message in flight
+    void acked(int slot) {
+        sim_worker &w = workers[slot];
+        long long now = clock->now();
+        switch (w.phase) {
+            case SIM_WAIT_REQUEST:
+                w.held[w.pending_index] += w.pending_amount;
+                w.latest_requested_resource_index = w.pending_index;
+                break;
+            case SIM_WAIT_RELEASE:
+                w.held[w.pending_index] -= w.pending_amount;
+                if (w.pending_index == w.latest_requested_resource_index && w.held[w.pending_index] == 0) update_latest(w);
+                break;
+            case SIM_WAIT_MASS: {
+                // request back what was released plus the new amount
+                MessageBuffer msg = message(w, 1);
+                for (int i = 0; i < geometry.resources; ++i) msg.resource_request[i] = w.released[i];
+                msg.resource_request[w.pending_index] += w.pending_amount;
+                send_waiting(slot, msg, SIM_WAIT_REREQUEST);
+                return;
+            }
+            case SIM_WAIT_REREQUEST:
+            case SIM_WAIT_EXCHANGE:
+                for (int i = 0; i < geometry.resources; ++i) w.held[i] += w.released[i];
+                w.held[w.pending_index] += w.pending_amount;
+                update_latest(w);
+                break;
+            default:
+                return;
+        }
+        w.next_action = now + w.cursor.gap(w.interval);
+        sleep(slot);
+    }
+};
+
+#endif
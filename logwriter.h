@@ -0,0 +1,120 @@
+#ifndef LOGWRITER_H
+#define LOGWRITER_H
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <signal.h>
+#include <pthread.h>
+#include "slots.h"
+
+#define LOG_BATCH 64              // records queued before the writer is woken early
+#define LOG_FLUSH_MS 20           // otherwise the writer flushes on this timer
+
+// background writer for OSS output
+//
+// callers push preformatted text onto a lock-free stack and return at once; the writer
+// thread takes the whole stack in one exchange, restores arrival order and writes the
+// batch to stdout and the log file with one flush each, so the scheduler never waits
+// on the terminal or the disk. the log file line cap is enforced here.
+class log_writer {
+    struct record {
+        std::string text;
+        bool to_file;
+        record *next;
+    };
+
+    std::atomic<record*> pending{nullptr};
+    std::atomic<int> queued{0};       // records pushed since the writer last took the stack
+    std::atomic<int> wake{0};         // futex word, bumped to wake the writer early
+    std::atomic<bool> stopping{false};
+    std::ofstream &file;
+    size_t max_file_lines;
+    size_t file_lines = 0;
+    size_t dropped_lines = 0;
+    std::thread writer;
+
+public:
+    log_writer(std::ofstream &file, size_t max_file_lines) : file(file), max_file_lines(max_file_lines) {
+        // signals stay with the scheduler thread, whose handlers stop the writer
+        sigset_t all, old;
+        sigfillset(&all);
+        pthread_sigmask(SIG_BLOCK, &all, &old);
+        writer = std::thread([this] { run(); });
+        pthread_sigmask(SIG_SETMASK, &old, nullptr);
+    }
+
+    // queue text for stdout and, unless to_file is false, the log file
+    void write(std::string text, bool to_file = true) {
+        record *r = new record{std::move(text), to_file, pending.load(std::memory_order_relaxed)};
+        while (!pending.compare_exchange_weak(r->next, r, std::memory_order_release, std::memory_order_relaxed)) {}
+        if (queued.fetch_add(1, std::memory_order_relaxed) + 1 == LOG_BATCH) futex_bump(&wake);
+    }
+
+    // write out everything queued and join the writer, safe to call more than once
+    void stop() {
+        if (!writer.joinable()) return;
+        stopping = true;
+        futex_bump(&wake);
+        writer.join();
+    }
+
+    // lines the cap kept out of the log file
+    size_t dropped() const { return dropped_lines; }
+
+private:
+    void run() {
+        const struct timespec interval = {0, LOG_FLUSH_MS * 1000000L};
+        while (true) {
+            int seen = wake.load();
+            bool last = stopping.load();
+            flush_batch();
+            if (last) return;
+            futex_wait(&wake, seen, &interval);
+        }
+    }
+
+    void flush_batch() {
+        record *r = pending.exchange(nullptr, std::memory_order_acquire);
+        queued = 0;
+        if (r == nullptr) return;
+
+        // the stack is newest first, reverse it into arrival order
+        record *in_order = nullptr;
+        while (r) {
+            record *next = r->next;
+            r->next = in_order;
+            in_order = r;
+            r = next;
+        }
+
+        std::string out, to_file;
+        for (record *cur = in_order; cur; ) {
+            out += cur->text;
+            if (cur->to_file && file.is_open()) {
+                size_t newlines = std::count(cur->text.begin(), cur->text.end(), '\n');
+                // skip any record that would take the file past the cap
+                if (file_lines + newlines <= max_file_lines) {
+                    to_file += cur->text;
+                    file_lines += newlines;
+                } else {
+                    dropped_lines += newlines;
+                }
+            }
+            record *next = cur->next;
+            delete cur;
+            cur = next;
+        }
+        std::cout.write(out.data(), out.size());
+        std::cout.flush();
+        if (!to_file.empty()) {
+            file.write(to_file.data(), to_file.size());
+            file.flush();
+        }
+    }
+};
+
+#endif
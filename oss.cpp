@@ -17,7 +17,27 @@
 #include <cstring>
 #include <algorithm>
 #include <chrono>
+#include <queue>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <shared_mutex>
 #include "resources.h"
+#include "slots.h"
+#include "simclock.h"
+#include "transport.h"
+#include "waitqueue.h"
+#include "deadlock.h"
+#include "banker.h"
+#include "logwriter.h"
+#include "trace.h"
+#include "histogram.h"
+#include "inproc.h"
+#include "shards.h"
+#include "fastfmt.h"
+#include "statseg.h"
+#include "workload.h"
+#include "grantpolicy.h"
 
 using namespace std;
 
@@ -27,55 +47,165 @@ struct PCB {
     int start_sec;
     int start_nano;
     int pcb_index;
-};
-
-struct MessageBuffer {
-    long mtype;
-    pid_t pid;
-    int request_or_release; // 1 for request, 0 for release
-    int resource_request[MAX_RESOURCES]; // array of resource requests
-    int resource_release[MAX_RESOURCES]; // array of resource releases
-    int mass_release; // 1 if mass release 0 if not
-    int process_running; // 1 if running, 0 if not
+    int next_free; // next free slot when this one is on the free list, -1 at the end
 };
 
 // Globals
 key_t sh_key = ftok("oss.cpp", 0);
-int shmid = shmget(sh_key, sizeof(int)*2, IPC_CREAT | 0666);
-int *shm_clock;
-int *sec;
-vector <PCB> table(MAX_PROCESSES);
-resource_descriptor resource_table;
-deque<MessageBuffer> process_queue;
+int shmid = shmget(sh_key, sizeof(sim_clock), IPC_CREAT | 0666);
+sim_clock *shm_clock;
+resource_geometry geometry;
+vector <PCB> table;
+unordered_map<pid_t, int> pid_to_pcb; // occupied slots by pid, kept in step with table
+shared_mutex pcb_lock;                // guards pid_to_pcb against lookups from receiver threads
+int free_pcb_head = -1;               // head of the intrusive free list threaded through table
+resource_descriptor_base *resource_table = nullptr;
+wait_queue process_queue;
+banker *avoidance = nullptr;          // set when -b turns on banker's avoidance
+grant_policy *grant_order = nullptr;  // order queued requests are granted in, -g
+bool split_reacquire = false;         // -x: out-of-order requests as a mass release, its ack and a second request
 const int increment_amount = 10000;
 
-// setup message queue
-key_t msg_key = ftok("oss.cpp", 1);
-int msgid = msgget(msg_key, IPC_CREAT | 0666);
+// worker <-> OSS message transport, set up in main once -T is known
+transport *channel = nullptr;
+string transport_kind = "msg";
+string wire_format = "compact";
+
+// -w inproc runs the simulated workers inside OSS, the pool is then also the channel
+inproc_pool *pool = nullptr;
+
+// -w pool keeps preforked worker processes that run one simulated process after another
+bool prefork = false;
+vector<pid_t> prefork_pids; // real pid of each pool member
+vector<int> prefork_idle;   // members waiting for their next simulated process
+
+// every simulated process gets a seed derived from the run seed (-S, else random) and its launch number
+uint64_t run_seed = 0;
+// workload source: gen (drawn from the seeds), record (drawn and written to workload_path, -C)
+// or replay (read back from workload_path, -L)
+string workload_mode = "gen";
+string workload_path = "";
+workload_recorder inproc_recorder; // -C with in-process workers, they append from the OSS thread
+workload_file replay_script;       // -L, the recording OSS checked and in-process workers replay
+
+// worker slot table, one entry per PCB slot
+key_t slot_key = ftok("oss.cpp", 2);
+int slot_shmid = shmget(slot_key, sizeof(slot_table), IPC_CREAT | 0666);
+slot_table *slot_tab;
+worker_slot *slots;                   // the shared slot table's, or OSS's own array for in-process workers
+vector<long long> last_woken;
+
+// -M live stats segment for ossmon, republished every stats_interval_ns of wall time
+stats_writer stats;
+long long stats_interval_ns = 0;
 
 // global log stream and helper so other functions can log to the same place as main
+// the writing itself happens on the log writer thread, started in main once the log file is open
 ofstream log_fs;
 static const size_t MAX_LOG_LINES = 10000;
-static size_t log_lines_written = 0;
-static inline void oss_log_msg(const string &s) {
-    // always print to stdout
-    cout << s;
-    if (!log_fs.is_open()) return;
-    size_t newlines = count(s.begin(), s.end(), '\n'); // count how many new lines this message contains
-    if (log_lines_written >= MAX_LOG_LINES) return; // if limit is reached, skip
-    if (log_lines_written + newlines > MAX_LOG_LINES) return; // skip message if it would exceed limit
-    // else write the whole message and update counter
-    log_fs << s;
-    log_fs.flush();
-    log_lines_written += newlines;
-}
-
-void increment_clock(int* sec, int* nano, long long inc_ns) {
-    const long long NSEC_PER_SEC = 1000000000LL;
+log_writer *logger = nullptr;
+static inline void oss_log_msg(const string &s, bool to_file = true) {
+    if (logger) logger->write(s, to_file);
+    else cout << s;
+}
+
+// binary event trace (-B), while it is open the per-event text lines are not formatted at all
+// receiver threads read it without the lock to pick trace or text, it is only dereferenced under trace_lock
+atomic<trace_writer*> tracer{nullptr};
+recursive_mutex trace_lock; // receiver threads trace grants and releases too
+static inline void trace_event(uint8_t op, pid_t pid, int pcb_index, const resvec *deltas, int aux = 0) {
+    if (!tracer.load()) return;
+    lock_guard<recursive_mutex> hold(trace_lock);
+    trace_writer *t = tracer.load();
+    if (!t || t->append(op, shm_clock->now(), pid, pcb_index, deltas, aux)) return;
+    // the file could not grow, fall back to the text log
+    cerr << "OSS: trace file could not be extended, tracing stopped after " << t->count() << " records" << endl;
+    tracer = nullptr;
+    delete t;
+}
+
+// while tracing, held across a change to the resource table and its trace record so that with
+// receiver threads changing the table too the records follow the order the changes were made in
+class trace_order {
+    unique_lock<recursive_mutex> hold;
+public:
+    trace_order() : hold(trace_lock, defer_lock) { if (tracer.load()) hold.lock(); }
+};
+
+// finish the trace file and stop tracing, safe while receiver threads are still tracing
+static void close_trace() {
+    lock_guard<recursive_mutex> hold(trace_lock);
+    trace_writer *t = tracer.exchange(nullptr);
+    if (!t) return;
+    t->close();
+    delete t;
+}
+
+void increment_clock(long long inc_ns) {
     if (inc_ns <= 0) inc_ns = 1; // guard against non-positive increments
-    long long total = (long long)(*nano) + inc_ns;
-    *sec += (int)(total / NSEC_PER_SEC);
-    *nano = (int)(total % NSEC_PER_SEC);
+    shm_clock->advance(inc_ns);
+}
+
+// event keys: launch, print, deadlock check, the earliest in-process worker deadline, then one per PCB slot
+const int EVENT_LAUNCH = 0;
+const int EVENT_PRINT = 1;
+const int EVENT_DEADLOCK = 2;
+const int EVENT_INPROC = 3;
+const int EVENT_WORKERS = 4;
+
+// min-heap of upcoming simulated-time events used by event-driven mode
+// each key has at most one armed time, stale heap entries are dropped lazily on peek
+class event_queue {
+    struct sim_event {
+        long long time;
+        int key;
+        bool operator>(const sim_event &o) const { return time > o.time; }
+    };
+    priority_queue<sim_event, vector<sim_event>, greater<sim_event>> heap;
+    vector<long long> armed;
+public:
+    explicit event_queue(int keys) : armed(keys, -1) {}
+
+    void arm(int key, long long time) {
+        if (armed[key] == time) return;
+        armed[key] = time;
+        heap.push({time, key});
+    }
+
+    void disarm(int key) { armed[key] = -1; }
+
+    // earliest armed event time, or -1 if nothing is armed
+    long long next() {
+        while (!heap.empty() && armed[heap.top().key] != heap.top().time) heap.pop();
+        return heap.empty() ? -1 : heap.top().time;
+    }
+};
+
+// true if some worker is acting or is about to act at the current time
+bool workers_due(long long now) {
+    if (pool) return pool->due(now);
+    for (int i = 0; i < geometry.processes; ++i) {
+        int state = slots[i].state.load();
+        if (state == SLOT_BUSY) return true;
+        if (state == SLOT_SLEEPING && slots[i].deadline.load() <= now) return true;
+    }
+    return false;
+}
+
+// wake every sleeping worker whose deadline the clock has reached, once per deadline
+void wake_due_workers(long long now) {
+    if (pool) {
+        pool->run_due(now);
+        return;
+    }
+    for (int i = 0; i < geometry.processes; ++i) {
+        if (slots[i].state.load() != SLOT_SLEEPING) continue;
+        long long deadline = slots[i].deadline.load();
+        if (deadline <= now && deadline != last_woken[i]) {
+            last_woken[i] = deadline;
+            futex_bump(&slots[i].wake_seq);
+        }
+    }
 }
 
 // convert float time interval to seconds and nanoseconds and return nannoseconds
@@ -96,7 +226,8 @@ pid_t child_Terminated() {
     return -1;
 }
 
-pid_t launch_worker(float time_limit) {
+// fork and exec ./worker for the simulated process launched launch-th, or with member >= 0 as that prefork pool member
+pid_t launch_worker(float time_limit, int pcb_index, long long launch, int member = -1) {
     pid_t worker_pid = fork();
     if (worker_pid < 0) {
         cerr << "fork failed" << endl;
@@ -106,10 +237,32 @@ pid_t launch_worker(float time_limit) {
     if (worker_pid == 0) {
         string arg_sec = to_string((int)time_limit);
         string arg_nsec = to_string(seconds_conversion(time_limit));
+        string arg_slot = to_string(pcb_index);
+        string arg_resources = to_string(geometry.resources);
+        string arg_instances = geometry.instance_list();
+        string arg_policy = avoidance ? "avoid" : "fits";
+        string arg_mode = (member >= 0) ? "pool" : "once";
+        string arg_member = to_string(member);
+        string arg_seed = to_string(derive_seed(run_seed, launch));
+        string arg_launch = to_string(launch);
+        string arg_reacquire = split_reacquire ? "split" : "exchange";
         char* args[] = {
             (char*)"./worker",
             const_cast<char*>(arg_sec.c_str()),
             const_cast<char*>(arg_nsec.c_str()),
+            const_cast<char*>(arg_slot.c_str()),
+            const_cast<char*>(transport_kind.c_str()),
+            const_cast<char*>(wire_format.c_str()),
+            const_cast<char*>(arg_resources.c_str()),
+            const_cast<char*>(arg_instances.c_str()),
+            const_cast<char*>(arg_policy.c_str()),
+            const_cast<char*>(arg_mode.c_str()),
+            const_cast<char*>(arg_member.c_str()),
+            const_cast<char*>(arg_seed.c_str()),
+            const_cast<char*>(arg_launch.c_str()),
+            const_cast<char*>(workload_mode.c_str()),
+            const_cast<char*>(workload_path.c_str()),
+            const_cast<char*>(arg_reacquire.c_str()),
             NULL
         };
         execv(args[0], args);
@@ -119,40 +272,367 @@ pid_t launch_worker(float time_limit) {
     return worker_pid;
 }
 
+// fork pool member `member`, it waits in the pool until a simulated process is assigned to it
+void spawn_prefork_member(int member) {
+    slot_tab->pool[member].assign_seq = 0;
+    prefork_pids[member] = launch_worker(0, -1, -1, member);
+    prefork_idle.push_back(member);
+}
+
+// hand the simulated process in pcb_index to an idle pool member, returns the member's pid or -1 if none is idle
+pid_t assign_prefork_member(int pcb_index, long long time_limit_ns, long long launch) {
+    if (prefork_idle.empty()) return -1;
+    int member = prefork_idle.back();
+    prefork_idle.pop_back();
+    pool_member &m = slot_tab->pool[member];
+    m.pcb_index = pcb_index;
+    m.time_limit_ns = time_limit_ns;
+    m.seed = derive_seed(run_seed, launch);
+    m.launch = launch;
+    futex_bump(&m.assign_seq);
+    return prefork_pids[member];
+}
+
+// the simulated process hosted by pid is over, its member goes back to the pool
+// a member killed by OSS is replaced with a fresh process
+void prefork_member_done(pid_t pid, bool killed) {
+    for (size_t member = 0; member < prefork_pids.size(); ++member) {
+        if (prefork_pids[member] != pid) continue;
+        if (killed) spawn_prefork_member((int)member);
+        else prefork_idle.push_back((int)member);
+        return;
+    }
+}
+
+// tell every pool member to exit instead of waiting for more work
+void release_prefork_pool() {
+    if (prefork_pids.empty()) return;
+    slot_tab->pool_shutdown = 1;
+    for (size_t member = 0; member < prefork_pids.size(); ++member) futex_bump(&slot_tab->pool[member].assign_seq);
+    prefork_pids.clear();
+}
+
 // find an empty PCB slot, return index or -1 if none found
 int find_empty_pcb(const vector<PCB> &table) {
-    for (size_t i = 0; i < table.size(); ++i) {
-        if (!table[i].occupied) {
-            return i;
-        }
-    }
+    return free_pcb_head;
+}
+
+// take the free slot pcb_index (as returned by find_empty_pcb) for a new worker
+void claim_pcb(vector<PCB> &table, int pcb_index, pid_t pid, long long start_total) {
+    free_pcb_head = table[pcb_index].next_free;
+    table[pcb_index].occupied = true;
+    table[pcb_index].pid = pid;
+    table[pcb_index].start_sec = clock_sec(start_total);
+    table[pcb_index].start_nano = clock_nano(start_total);
+    table[pcb_index].pcb_index = pcb_index;
+    table[pcb_index].next_free = -1;
+    unique_lock<shared_mutex> hold(pcb_lock);
+    pid_to_pcb[pid] = pcb_index;
+}
+
+// index of the first resource the request needs more of than is available, -1 if it fits
+int first_short_resource(const resvec &request) {
+    return resource_table->first_short(request);
+}
+
+// move instances from the available pool into pcb_index's allocation row
+void allocate_resources(int pcb_index, const resvec &amounts) {
+    resource_table->allocate(pcb_index, amounts);
+}
+
+// let waiters blocked on the classes set in mask be rechecked
+void mark_released(uint64_t mask) {
+    for (uint64_t bits = mask; bits; bits &= bits - 1) process_queue.released(__builtin_ctzll(bits));
+}
+
+// return instances to the available pool and let waiters blocked on them be rechecked
+void release_resources(int pcb_index, const resvec &amounts) {
+    resource_table->release(pcb_index, amounts);
+    mark_released(resvec_nonzero_mask(amounts));
+}
+
+// -1 if the request can be granted now, else the wait queue bucket to file it under:
+// the first resource it is short of, or WAIT_UNSAFE if it fits but avoidance holds it back
+int grant_blocker(int pcb_index, const resvec &request) {
+    int short_resource = first_short_resource(request);
+    if (short_resource != -1) return short_resource;
+    if (avoidance && !avoidance->safe_to_grant(*resource_table, pcb_index, request)) return WAIT_UNSAFE;
     return -1;
 }
 
+// bucket for a request the grant order keeps behind others: what it is short of, else WAIT_BEHIND
+int behind_bucket(const resvec &request) {
+    int short_resource = first_short_resource(request);
+    return (short_resource == -1) ? WAIT_BEHIND : short_resource;
+}
+
+// why a request filed under bucket had to wait, as logged
+static const char* queued_reason(int bucket) {
+    if (bucket == WAIT_UNSAFE) return "Granting would be unsafe";
+    if (bucket == WAIT_BEHIND) return "Requests ahead of it are waiting";
+    return "Resources not available";
+}
+
+// grant request to pcb_index if it can be granted now: -1 if it was allocated, else the wait queue
+// bucket to file it under; without avoidance the check and the allocation are one atomic step
+int try_grant(int pcb_index, const resvec &request) {
+    if (!avoidance) return resource_table->try_allocate(pcb_index, request);
+    int short_resource = grant_blocker(pcb_index, request);
+    if (short_resource == -1) allocate_resources(pcb_index, request);
+    return short_resource;
+}
+
+// a worker is gone, its claim no longer counts against anyone
+void retire_claim(int pcb_index) {
+    if (!avoidance) return;
+    avoidance->retire(pcb_index);
+    process_queue.safety_changed();
+}
+
 int find_pcb_by_pid(pid_t pid) {
-    for (size_t i = 0; i < table.size(); ++i) {
-        if (table[i].occupied && table[i].pid == pid) {
-            return (int)i;
+    shared_lock<shared_mutex> hold(pcb_lock);
+    auto it = pid_to_pcb.find(pid);
+    return (it == pid_to_pcb.end()) ? -1 : it->second;
+}
+
+int remove_pcb(vector<PCB> &table, pid_t pid) {
+    int i;
+    {
+        unique_lock<shared_mutex> hold(pcb_lock);
+        auto it = pid_to_pcb.find(pid);
+        if (it == pid_to_pcb.end()) return -1;
+        i = it->second;
+        pid_to_pcb.erase(it);
+    }
+    table[i].occupied = false;
+    table[i].pid = -1;
+    table[i].start_sec = 0;
+    table[i].start_nano = 0;
+    table[i].pcb_index = -1;
+    table[i].next_free = free_pcb_head;
+    free_pcb_head = i;
+    return i;
+}
+
+// terminate the worker in pcb_index, return everything it holds and free its PCB and slot
+// trace_op records why, with what it held
+void terminate_worker(int pcb_index, pid_t pid, uint8_t trace_op) {
+    if (pool) pool->kill(pcb_index);
+    else kill(pid, SIGTERM);
+    if (prefork) prefork_member_done(pid, true);
+    process_queue.remove_pid(pid);
+    {
+        trace_order order;
+        resvec held = resource_table->row(pcb_index);
+        trace_event(trace_op, pid, pcb_index, &held);
+        release_resources(pcb_index, held);
+    }
+    remove_pcb(table, pid);
+    retire_claim(pcb_index);
+    slots[pcb_index].state = SLOT_EMPTY;
+}
+
+// run the deadlock detector and terminate victims until every blocked process can finish
+// returns how many workers were terminated
+int resolve_deadlocks(deadlock_detector &detector) {
+    if (!detector.needs_run()) return 0;
+    int victims = 0;
+    while (true) {
+        vector<pair<long long, blocked_process>> queued;
+        process_queue.for_each([&](const waiter &w) {
+            int pcb_index = find_pcb_by_pid(w.msg.pid);
+            if (pcb_index != -1) queued.push_back({w.seq, {pcb_index, w.need, w.seq}});
+        });
+        // a strict grant order is part of what can deadlock, the detector needs arrival order
+        if (grant_order->strict()) sort(queued.begin(), queued.end(), [](const pair<long long, blocked_process> &a, const pair<long long, blocked_process> &b) { return a.first < b.first; });
+        vector<blocked_process> blocked;
+        for (const pair<long long, blocked_process> &q : queued) blocked.push_back(q.second);
+        vector<int> deadlocked = grant_order->strict() ? detector.detect_in_order(*resource_table, blocked) : detector.detect(*resource_table, blocked);
+        if (deadlocked.empty()) return victims;
+
+        int victim = detector.choose_victim(*resource_table, deadlocked);
+        pid_t victim_pid = table[victim].pid;
+        {
+            ostringstream ss;
+            ss << "OSS: Deadlock detected among workers";
+            for (int p : deadlocked) ss << " " << table[p].pid;
+            ss << " at time " << shm_clock->sec() << "s " << shm_clock->nano() << "ns" << endl;
+            if (!tracer) {
+                ss << "OSS: Terminating worker " << victim_pid << " to resolve deadlock, releasing ";
+                for (int i = 0; i < geometry.resources; i++) {
+                    if (resource_table->allocated(victim, i) > 0) ss << "R" << i << ":" << resource_table->allocated(victim, i) << " ";
+                }
+                ss << endl;
+            }
+            oss_log_msg(ss.str());
         }
+        terminate_worker(victim, victim_pid, TRACE_DEADLOCK_KILL);
+        detector.stats.victims++;
+        victims++;
     }
-    return -1;
 }
 
-int remove_pcb(vector<PCB> &table, pid_t pid) {
+// "OSS: available resources: R0:3 R1:5 ..." line
+static void print_available(ostringstream &ss) {
+    resvec available = resource_table->available_vector();
+    ss << "OSS: available resources: ";
+    for (int i = 0; i < geometry.resources; i++) {
+        ss << "R" << i << ":" << available[i] << " ";
+    }
+    ss << endl;
+}
+
+void log_grant(const MessageBuffer &msg) {
+    ostringstream ss;
+    ss << "OSS: Resources allocated to worker " << msg.pid << " ";
+    for (int i = 0; i < geometry.resources; i++) {
+        if (msg.resource_request[i] > 0) ss << "R" << i << ":" << msg.resource_request[i] << " ";
+    }
+    ss << "at time " << shm_clock->sec() << "s " << shm_clock->nano() << "ns" << endl;
+    print_available(ss);
+    oss_log_msg(ss.str());
+}
+
+void log_release(const MessageBuffer &msg) {
+    ostringstream ss;
+    ss << "OSS: Resources released by worker " << msg.pid << " ";
+    for (int i = 0; i < geometry.resources; i++) {
+        if (msg.resource_release[i] > 0) ss << "R" << i << ":" << msg.resource_release[i] << " ";
+    }
+    ss << "at time " << shm_clock->sec() << "s " << shm_clock->nano() << "ns" << endl;
+    print_available(ss);
+    oss_log_msg(ss.str());
+}
+
+// p50/p90/p99/max of one histogram, in microseconds for wall time and nanoseconds for simulated time
+static void print_percentiles(ostringstream &ss, const latency_histogram &h, long long unit) {
+    ss << "n=" << h.count() << " p50=" << h.percentile(0.50) / unit << " p90=" << h.percentile(0.90) / unit
+       << " p99=" << h.percentile(0.99) / unit << " max=" << h.max() / unit;
+}
+
+// request -> grant latency, overall and, with per_resource, one line for each resource
+void print_latency(const latency_stats &latency, bool per_resource) {
+    ostringstream ss;
+    ss << "Request->grant latency, simulated ns: ";
+    print_percentiles(ss, latency.sim_all, 1);
+    ss << endl << "Request->grant latency, wall us: ";
+    print_percentiles(ss, latency.wall_all, 1000);
+    ss << endl;
+    if (per_resource) {
+        for (size_t r = 0; r < latency.sim_by_resource.size(); ++r) {
+            ss << "  R" << r << " simulated ns: ";
+            print_percentiles(ss, latency.sim_by_resource[r], 1);
+            ss << " | wall us: ";
+            print_percentiles(ss, latency.wall_by_resource[r], 1000);
+            ss << endl;
+        }
+    }
+    ss << endl;
+    oss_log_msg(ss.str());
+}
+
+// -u: the tables are dumped as the rows changed since the last dump, with a full one every incremental_every dumps
+int incremental_every = 0;
+long long process_table_dumps = 0;
+long long allocation_dumps = 0;
+vector<PCB> last_table;      // process table as of its last dump
+vector<resvec> last_rows;    // allocation rows as of their last dump
+
+static bool same_pcb(const PCB &a, const PCB &b) {
+    return a.occupied == b.occupied && a.pid == b.pid && a.start_sec == b.start_sec && a.start_nano == b.start_nano;
+}
+
+void print_process_table_changes(const vector<PCB> &table) {
+    bool full = (process_table_dumps++ % incremental_every == 0) || last_table.size() != table.size();
+    string rows;
+    int changed = 0;
     for (size_t i = 0; i < table.size(); ++i) {
-        if (table[i].occupied && table[i].pid == pid) {
-            table[i].occupied = false;
-            table[i].pid = -1;
-            table[i].start_sec = 0;
-            table[i].start_nano = 0;
-            table[i].pcb_index = -1;
-            return i;
+        const PCB &p = table[i];
+        if (!full && same_pcb(p, last_table[i])) continue;
+        changed++;
+        put_int(rows, i, 6, true);
+        put_int(rows, p.occupied ? 1 : 0, 10, true);
+        if (p.occupied) {
+            put_int(rows, p.pid, 12, true);
+            put_int(rows, p.start_sec, 12, true);
+            put_int(rows, p.start_nano, 12, true);
+        } else {
+            put_field(rows, "-", 12, true);
+            put_field(rows, "-", 12, true);
+            put_field(rows, "-", 12, true);
         }
+        rows += '\n';
     }
-    return -1;
+    if (changed == 0) return;
+    last_table = table;
+
+    string out;
+    if (!full) {
+        out += "Process table, changed rows: ";
+        put_int(out, changed, 0, true);
+        out += '\n';
+    }
+    put_field(out, "Index", 6, true);
+    put_field(out, "Occ", 10, true);
+    put_field(out, "PID", 12, true);
+    put_field(out, "StartSec", 12, true);
+    put_field(out, "StartNano", 12, true);
+    out += '\n';
+    out.append(52, '-');
+    out += '\n';
+    out += rows;
+    out += '\n';
+    oss_log_msg(out);
+}
+
+void print_allocation_matrix_changes(const resource_descriptor_base &resources) {
+    const int proc_col = 8;
+    const int res_col = 8;
+    int processes = resources.num_processes();
+    bool full = (allocation_dumps++ % incremental_every == 0) || (int)last_rows.size() != processes;
+    last_rows.resize(processes);
+    string rows;
+    int changed = 0;
+    for (int p = 0; p < processes; ++p) {
+        resvec row = resources.row(p);
+        if (!full && memcmp(row.v, last_rows[p].v, sizeof(row.v)) == 0) continue;
+        last_rows[p] = row;
+        changed++;
+        put_int(rows, p, proc_col, true);
+        for (int r = 0; r < resources.num_resources(); ++r) put_int(rows, row[r], res_col, false);
+        rows += '\n';
+    }
+    if (changed == 0) return;
+
+    string out;
+    if (!full) {
+        out += "Allocation matrix, changed rows: ";
+        put_int(out, changed, 0, true);
+        out += '\n';
+    }
+    put_field(out, "Index", proc_col, true);
+    for (int r = 0; r < resources.num_resources(); ++r) {
+        char name[24];
+        name[0] = 'R';
+        char *end = name + sizeof(name);
+        char *digits = int_text(end, r);
+        size_t n = end - digits;
+        memmove(name + 1, digits, n);
+        put_field(out, name, n + 1, res_col, false);
+    }
+    out += '\n';
+    out.append(proc_col + res_col * resources.num_resources(), '-');
+    out += '\n';
+    out += rows;
+    out += '\n';
+    oss_log_msg(out);
 }
 
 void print_process_table(const std::vector<PCB> &table, bool verbose) {
+    if (incremental_every > 0) {
+        print_process_table_changes(table);
+        return;
+    }
     ostringstream ss;
     using std::endl;
     ss << std::left
@@ -181,7 +661,11 @@ void print_process_table(const std::vector<PCB> &table, bool verbose) {
 
 }
 
-void print_allocation_matrix(const std::array<std::array<int, MAX_RESOURCES>, MAX_PROCESSES> &allocation_matrix, bool verbose) {
+void print_allocation_matrix(const resource_descriptor_base &resources, bool verbose) {
+    if (incremental_every > 0) {
+        print_allocation_matrix_changes(resources);
+        return;
+    }
     using std::endl;
     std::ostringstream ss;
 
@@ -190,19 +674,19 @@ void print_allocation_matrix(const std::array<std::array<int, MAX_RESOURCES>, MA
 
     // Header
     ss << std::left << std::setw(proc_col) << "Index";
-    for (int r = 0; r < MAX_RESOURCES; ++r) {
+    for (int r = 0; r < resources.num_resources(); ++r) {
         ss << std::right << std::setw(res_col) << ("R" + std::to_string(r));
     }
     ss << endl;
 
     // Separator
-    ss << std::string(proc_col + res_col * MAX_RESOURCES, '-') << endl;
+    ss << std::string(proc_col + res_col * resources.num_resources(), '-') << endl;
 
     // Rows
-    for (int p = 0; p < MAX_PROCESSES; ++p) {
+    for (int p = 0; p < resources.num_processes(); ++p) {
         ss << std::left << std::setw(proc_col) << p;
-        for (int r = 0; r < MAX_RESOURCES; ++r) {
-            ss << std::right << std::setw(res_col) << allocation_matrix[p][r];
+        for (int r = 0; r < resources.num_resources(); ++r) {
+            ss << std::right << std::setw(res_col) << resources.allocated(p, r);
         }
         ss << endl;
     }
@@ -210,25 +694,101 @@ void print_allocation_matrix(const std::array<std::array<int, MAX_RESOURCES>, MA
     oss_log_msg(ss.str());
 }
 
+// set by SIGALRM/SIGINT, the main loop shuts down when it sees it
+volatile sig_atomic_t stop_signal = 0;
+
+// only async-signal-safe work here: note the signal and wake the main loop if it sleeps on the doorbell
 void signal_handler(int sig) {
     if (sig == SIGALRM || sig == SIGINT) {
-        cout << "Received SIGALRM or SIGINT, terminating all child processes..." << endl;
-        // Terminate all child processes and clean up shared memory
-        shmdt(shm_clock);
-        shmctl(shmid, IPC_RMID, nullptr);
-        msgctl(msgid, IPC_RMID, nullptr);
-        kill(0, SIGTERM); 
-        exit(0);
+        stop_signal = 1;
+        if (slot_tab) futex_bump(&slot_tab->doorbell);
     }
 }
 
+// the main loop saw stop_signal: flush the log, remove the IPC objects and take the workers down
+void shutdown_on_signal() {
+    if (logger) logger->stop();
+    cout << "Received SIGALRM or SIGINT, terminating all child processes..." << endl;
+    // Terminate all child processes and clean up shared memory
+    shmdt(shm_clock);
+    shmctl(shmid, IPC_RMID, nullptr);
+    shmctl(slot_shmid, IPC_RMID, nullptr);
+    stats.remove();
+    if (channel) channel->remove();
+    close_trace();
+    kill(0, SIGTERM);
+    exit(0);
+}
 void exit_handler() {
+    if (logger) logger->stop();
+    release_prefork_pool();
     shmdt(shm_clock);
     shmctl(shmid, IPC_RMID, nullptr);
-    msgctl(msgid, IPC_RMID, nullptr);
+    shmctl(slot_shmid, IPC_RMID, nullptr);
+    stats.remove();
+    if (channel) channel->remove();
+    close_trace();
     exit(1);
 }
 
+// a receiver thread's own latency histograms and message counts
+struct receiver_state {
+    mutex lock; // held while recording and while the scheduler thread merges the histograms
+    latency_stats latency;
+    long long handled = 0;
+    long long handed_off = 0;
+    explicit receiver_state(int resources) : latency(resources) {}
+};
+
+// messages the receiver threads leave for the scheduler thread, with their arrival time
+class handoff_queue {
+    mutex lock;
+    deque<pair<MessageBuffer, long long>> items;
+public:
+    void push(const MessageBuffer &msg, long long wall) {
+        lock_guard<mutex> hold(lock);
+        items.push_back({msg, wall});
+    }
+
+    // move up to max messages into batch and their arrival times into walls, returns how many
+    int take(vector<MessageBuffer> &batch, vector<long long> &walls, size_t max) {
+        batch.clear();
+        walls.clear();
+        lock_guard<mutex> hold(lock);
+        while (!items.empty() && batch.size() < max) {
+            batch.push_back(items.front().first);
+            walls.push_back(items.front().second);
+            items.pop_front();
+        }
+        return (int)batch.size();
+    }
+};
+
+// -X receiver threads
+int receivers = 0;
+handoff_queue handoffs;
+atomic<uint64_t> released_by_receivers{0}; // classes receivers returned to the pool, not yet seen by the wait queue
+atomic<bool> receivers_stop{false};
+atomic<bool> receivers_failed{false}; // a receiver hit a transport error, the scheduler thread shuts down
+
+// acks decided during a loop pass, sent together once the pass has handled its messages
+vector<pair<int, pid_t>> pending_acks;
+
+void queue_ack(int pcb_index, pid_t pid) {
+    if (pcb_index != -1) slots[pcb_index].state = SLOT_BUSY;
+    pending_acks.push_back({pcb_index, pid});
+}
+
+void flush_acks() {
+    for (const pair<int, pid_t> &a : pending_acks) {
+        if (!channel->ack(a.first, a.second)) {
+            perror("oss msgsnd ack failed");
+            exit_handler();
+        }
+    }
+    pending_acks.clear();
+}
+
 // helper to detect empty/blank optarg
 static inline bool optarg_blank(const char* s) {
     return (s == nullptr) || (s[0] == '\0');
@@ -241,10 +801,20 @@ int main(int argc, char* argv[]) {
     float time_limit = -1;
     float launch_interval = -1;
     bool verbose_mode = false;
+    bool event_mode = false;
+    bool avoidance_mode = false;
+    bool drain_all = false;
+    float deadlock_interval = 1.0f;
     string log_file = "";
+    string trace_file = "";
+    string instance_arg = "";
+    bool resources_given = false;
+    string worker_mode = "fork";
+    string policy_arg = "first-fit";
+    bool seed_given = false;
     int opt;
 
-    while((opt = getopt(argc, argv, "hn:s:t:i:f:v")) != -1) {
+    while((opt = getopt(argc, argv, "hn:s:t:i:f:veT:W:R:I:P:d:bB:w:DX:u:M:S:C:L:g:x")) != -1) {
         switch(opt) {
             case 'h': {
                 cout << "Usage: oss -n proc -s simul -t time_limit -i launch_interval\n"
@@ -256,6 +826,28 @@ int main(int argc, char* argv[]) {
                     << "  -i launch_interval Interval between launching worker processes in seconds (non-negative float)\n"
                     << "  -f logfile        Log file name (optional)\n"
                     << "  -v                Turn on verbose mode\n"
+                    << "  -e                Event-driven clock: jump to the next event instead of fixed ticks\n"
+                    << "  -T transport      Worker message transport: msg (SysV queue, default) or ring (shared memory rings)\n"
+                    << "  -W format         Message queue wire format: compact (default) or legacy (full resource arrays)\n"
+                    << "  -R count          Number of resource classes (1-" << MAX_RESOURCES << ", default " << DEFAULT_RESOURCES << ")\n"
+                    << "  -I instances      Instances per class: one count for every class or a comma separated list (default " << MAX_INSTANCES << ")\n"
+                    << "  -d interval       Simulated seconds between deadlock checks (default 1, 0 disables)\n"
+                    << "  -P size           Process table size (1-" << MAX_PROCESSES << ", up to " << MAX_INPROC_PROCESSES << " with -w inproc, default " << DEFAULT_PROCESSES << ")\n"
+                    << "  -b                Banker's avoidance: workers declare a maximum claim, only safe requests are granted\n"
+                    << "  -g policy         Order queued requests are granted in: first-fit (default), fifo (strict arrival order),\n"
+                    << "                    smallest (fewest instances first) or aging[:ms] (smallest first, one instance less per ms waited, default 100)\n"
+                    << "  -x                Out-of-order requests as a mass release, its ack and a second request instead of\n"
+                    << "                    one release-and-reacquire message\n"
+                    << "  -D                Drain every pending message each loop pass and send the acks together\n"
+                    << "  -X receivers      Receiver threads that grant and release against a sharded resource table (default 0, msg transport only)\n"
+                    << "  -w workers        Worker processes: fork (./worker per process, default), pool (preforked ./workers reused\n"
+                    << "                    for one process after another) or inproc (simulated inside OSS)\n"
+                    << "  -u every          Dump only the table rows changed since the last dump, with a full dump every N dumps\n"
+                    << "  -M ms             Publish live stats every ms wall milliseconds to a shared segment for ossmon\n"
+                    << "  -S seed           Run seed, every worker's choices are drawn from a seed derived from it (default random)\n"
+                    << "  -C file           Record every worker's choices to file for replay\n"
+                    << "  -L file           Replay the worker choices recorded in file instead of drawing them\n"
+                    << "  -B tracefile      Write per-event records to a binary trace instead of the text log (decode with tracedump)\n"
                     << "Example:\n"
                     << "  ./oss -n 10 -s 3 -t 2.5 -i 0.5 -f oss.log\n";
                 exit_handler();
@@ -333,6 +925,163 @@ int main(int argc, char* argv[]) {
                 verbose_mode = true;
                 break;
             }
+            case 'e': {
+                event_mode = true;
+                break;
+            }
+            case 'b': {
+                avoidance_mode = true;
+                break;
+            }
+            case 'D': {
+                drain_all = true;
+                break;
+            }
+            case 'x': {
+                split_reacquire = true;
+                break;
+            }
+            case 'u': {
+                try {
+                    int val = stoi(optarg);
+                    if (val < 1) throw invalid_argument("non-positive");
+                    incremental_every = val;
+                } catch (...) {
+                    cerr << "Error: -u must be a positive integer." << endl;
+                    exit_handler();
+                }
+                break;
+            }
+            case 'M': {
+                try {
+                    int val = stoi(optarg);
+                    if (val < 1) throw invalid_argument("non-positive");
+                    stats_interval_ns = val * 1000000LL;
+                } catch (...) {
+                    cerr << "Error: -M must be a positive number of milliseconds." << endl;
+                    exit_handler();
+                }
+                break;
+            }
+            case 'S': {
+                try {
+                    size_t used = 0;
+                    run_seed = stoull(optarg, &used);
+                    if (used != strlen(optarg)) throw invalid_argument("trailing characters");
+                    seed_given = true;
+                } catch (...) {
+                    cerr << "Error: -S must be a non-negative integer." << endl;
+                    exit_handler();
+                }
+                break;
+            }
+            case 'C':
+            case 'L': {
+                if (optarg_blank(optarg)) {
+                    cerr << "Error: -" << (char)opt << " requires a file name." << endl;
+                    exit_handler();
+                }
+                if (workload_mode != "gen") {
+                    cerr << "Error: -C and -L cannot be combined." << endl;
+                    exit_handler();
+                }
+                workload_mode = (opt == 'C') ? "record" : "replay";
+                workload_path = optarg;
+                break;
+            }
+            case 'g': {
+                if (optarg_blank(optarg)) {
+                    cerr << "Error: -g requires a policy name." << endl;
+                    exit_handler();
+                }
+                policy_arg = optarg;
+                break;
+            }
+            case 'X': {
+                try {
+                    int val = stoi(optarg);
+                    if (val < 0 || val > 64) throw invalid_argument("range");
+                    receivers = val;
+                } catch (...) {
+                    cerr << "Error: -X must be an integer from 0 to 64." << endl;
+                    exit_handler();
+                }
+                break;
+            }
+            case 'B': {
+                if (optarg_blank(optarg)) {
+                    cerr << "Error: -B requires a non-blank filename." << endl;
+                    exit_handler();
+                }
+                trace_file = optarg;
+                break;
+            }
+            case 'T': {
+                if (optarg_blank(optarg) || (string(optarg) != "msg" && string(optarg) != "ring")) {
+                    cerr << "Error: -T must be msg or ring." << endl;
+                    exit_handler();
+                }
+                transport_kind = optarg;
+                break;
+            }
+            case 'W': {
+                if (optarg_blank(optarg) || (string(optarg) != "compact" && string(optarg) != "legacy")) {
+                    cerr << "Error: -W must be compact or legacy." << endl;
+                    exit_handler();
+                }
+                wire_format = optarg;
+                break;
+            }
+            case 'R': {
+                try {
+                    int val = stoi(optarg);
+                    if (val < 1 || val > MAX_RESOURCES) throw invalid_argument("range");
+                    geometry.resources = val;
+                    resources_given = true;
+                } catch (...) {
+                    cerr << "Error: -R must be an integer from 1 to " << MAX_RESOURCES << "." << endl;
+                    exit_handler();
+                }
+                break;
+            }
+            case 'I': {
+                if (optarg_blank(optarg)) {
+                    cerr << "Error: -I requires a non-blank argument." << endl;
+                    exit_handler();
+                }
+                instance_arg = optarg;
+                break;
+            }
+            case 'd': {
+                try {
+                    float val = stof(optarg);
+                    if (val < 0.0f) throw invalid_argument("negative");
+                    deadlock_interval = val;
+                } catch (...) {
+                    cerr << "Error: -d must be a non-negative number." << endl;
+                    exit_handler();
+                }
+                break;
+            }
+            case 'P': {
+                try {
+                    int val = stoi(optarg);
+                    if (val < 1 || val > MAX_INPROC_PROCESSES) throw invalid_argument("range");
+                    geometry.processes = val;
+                } catch (...) {
+                    cerr << "Error: -P must be an integer from 1 to " << MAX_PROCESSES << " (" << MAX_INPROC_PROCESSES << " with -w inproc)." << endl;
+                    exit_handler();
+                }
+                break;
+            }
+            case 'w': {
+                if (optarg_blank(optarg) || (string(optarg) != "fork" && string(optarg) != "pool" && string(optarg) != "inproc")) {
+                    cerr << "Error: -w must be fork, pool or inproc." << endl;
+                    exit_handler();
+                }
+                worker_mode = optarg;
+                break;
+            }
             default:
                 cerr << "Error: Unknown option or missing argument." << endl;
                 exit_handler();
@@ -345,33 +1094,135 @@ int main(int argc, char* argv[]) {
         exit_handler();
     }
 
+    // resolve the resource geometry, a list of instance counts also fixes the class count
+    if (!instance_arg.empty()) {
+        int requested_resources = geometry.resources;
+        if (!geometry.parse_instances(instance_arg)) {
+            cerr << "Error: -I must be a positive count or a comma separated list of up to " << MAX_RESOURCES << " counts." << endl;
+            exit_handler();
+        }
+        if (resources_given && geometry.resources != requested_resources) {
+            cerr << "Error: -I lists " << geometry.resources << " classes but -R asks for " << requested_resources << "." << endl;
+            exit_handler();
+        }
+    }
+    if (worker_mode != "inproc" && geometry.processes > MAX_PROCESSES) {
+        cerr << "Error: -P above " << MAX_PROCESSES << " needs -w inproc." << endl;
+        exit_handler();
+    }
+    if (receivers > 0 && (worker_mode == "inproc" || transport_kind != "msg" || avoidance_mode)) {
+        cerr << "Error: -X needs the msg transport and forked or pooled workers, and cannot be combined with -b." << endl;
+        exit_handler();
+    }
+    grant_order = make_grant_policy(policy_arg);
+    if (grant_order == nullptr) {
+        cerr << "Error: -g must be first-fit, fifo, smallest or aging[:ms]." << endl;
+        exit_handler();
+    }
+    if (receivers > 0 && !grant_order->grants_on_arrival()) {
+        cerr << "Error: -g " << policy_arg << " cannot be combined with -X, receiver threads grant on arrival." << endl;
+        exit_handler();
+    }
+    if (avoidance_mode && grant_order->strict()) {
+        cerr << "Error: -g fifo cannot be combined with -b, a request held back as unsafe would hold up every request behind it." << endl;
+        exit_handler();
+    }
+    if (!seed_given) run_seed = ((uint64_t)random_device{}() << 32) | random_device{}();
+    if (workload_mode == "record" && !workload_record_begin(workload_path)) {
+        cerr << "Error: Could not create workload file " << workload_path << endl;
+        exit_handler();
+    }
+    if (workload_mode == "replay") {
+        if (!replay_script.open(workload_path)) {
+            cerr << "Error: " << workload_path << " is not a recorded workload" << endl;
+            exit_handler();
+        }
+        if (replay_script.resources() != geometry.resources || replay_script.avoidance() != avoidance_mode) {
+            cerr << "Error: " << workload_path << " was recorded with " << replay_script.resources() << " resource classes"
+                 << (replay_script.avoidance() ? " and -b" : " and without -b") << ", run with the same." << endl;
+            exit_handler();
+        }
+        int bad_resource = 0, bad_value = 0;
+        long long bad_launch = replay_script.avoidance() ? replay_script.bad_claim(geometry, bad_resource, bad_value) : -1;
+        if (bad_launch != -1) {
+            cerr << "Error: " << workload_path << " process " << bad_launch << " claims " << bad_value << " of R" << bad_resource
+                 << ", claims must be listed per class in order and fit -I " << geometry.instance_list() << "." << endl;
+            exit_handler();
+        }
+    }
+    resource_table = (receivers > 0) ? new sharded_resource_descriptor(geometry) : make_resource_descriptor(geometry);
+    table.resize(geometry.processes);
+    if (avoidance_mode) avoidance = new banker(geometry);
+
     // attach shared memory to shm_ptr
-    shm_clock = (int*) shmat(shmid, nullptr, 0);
-    if (shm_clock == (int*) -1) {
+    shm_clock = (sim_clock*) shmat(shmid, nullptr, 0);
+    if (shm_clock == (sim_clock*) -1) {
+        cerr << "shmat";
+        exit_handler();
+    }
+
+    shm_clock->set(0);
+
+    // attach worker slot table
+    slot_tab = (slot_table*) shmat(slot_shmid, nullptr, 0);
+    if (slot_tab == (slot_table*) -1) {
         cerr << "shmat";
         exit_handler();
     }
+    slots = (worker_mode == "inproc") ? new worker_slot[geometry.processes] : slot_tab->slots;
+    last_woken.assign(geometry.processes, -1);
+    slot_tab->doorbell = 0;
+    slot_tab->pool_shutdown = 0;
+    for (int i = 0; i < geometry.processes; ++i) {
+        slots[i].state = SLOT_EMPTY;
+        slots[i].deadline = 0;
+        slots[i].wake_seq = 0;
+    }
+
+    // setup worker transport, in-process workers talk to OSS through the pool itself
+    if (worker_mode == "inproc") {
+        pool = new inproc_pool(geometry, shm_clock, slots, avoidance_mode);
+        pool->split_reacquire(split_reacquire);
+        if (workload_mode == "record" && !inproc_recorder.open(workload_path)) {
+            cerr << "Error: Could not open workload file " << workload_path << endl;
+            exit_handler();
+        }
+        pool->use_workload(inproc_recorder.is_open() ? &inproc_recorder : nullptr, workload_mode == "replay" ? &replay_script : nullptr);
+        channel = pool;
+        transport_kind = "inproc";
+    } else {
+        channel = make_transport(transport_kind, wire_format, true, geometry.processes);
+    }
+    if (channel == nullptr) {
+        cerr << "Error: could not set up " << transport_kind << " transport" << endl;
+        exit_handler();
+    }
 
-    // pointers to seconds and nanoseconds in shared memory
-    int *sec = &(shm_clock[0]);
-    int *nano = &(shm_clock[1]);
-    *sec = *nano = 0;
+    // prefork pool: one member per simulated process that can run at once
+    if (worker_mode == "pool") {
+        prefork = true;
+        int members = min(min(simul, geometry.processes), max(proc, 1));
+        prefork_pids.assign(members, -1);
+        for (int member = members - 1; member >= 0; --member) spawn_prefork_member(member);
+    }
 
-    // Initialize PCB 
+    // Initialize PCB, every slot starts on the free list in index order
     for (size_t i = 0; i < table.size(); ++i) {
         table[i].occupied = false;
         table[i].pid = -1;
         table[i].start_sec = 0;
         table[i].start_nano = 0;
         table[i].pcb_index = -1;
+        table[i].next_free = (i + 1 < table.size()) ? (int)(i + 1) : -1;
     }
+    free_pcb_head = table.empty() ? -1 : 0;
+    pid_to_pcb.reserve(geometry.processes);
 
     time_t start_time = time(nullptr); // track time for 5 second real-time limit
 
     // print interval using simulated clock: 0.5 seconds
-    const long long NSEC_PER_SEC = 1000000000LL;
     const long long PRINT_INTERVAL_NANO = 500000000LL;
-    long long next_print_total = (long long)(*sec) * NSEC_PER_SEC + (long long)(*nano) + PRINT_INTERVAL_NANO;
+    long long next_print_total = shm_clock->now() + PRINT_INTERVAL_NANO;
 
     // signal handling
     signal(SIGALRM, signal_handler);
@@ -379,8 +1230,7 @@ int main(int argc, char* argv[]) {
     alarm(60);
 
     // Initialize random number generator
-    random_device rd;
-    mt19937 gen(rd());
+    mt19937 gen(run_seed);
     uniform_real_distribution<double> dis(1, time_limit);
 
     // open log file if specified
@@ -392,11 +1242,22 @@ int main(int argc, char* argv[]) {
         }
     }
 
-    // helper to log messages originating from OSS (writes to stdout and to log file if open)
-    auto oss_log = [&](const string &s) {
-        cout << s;
-        if (log_fs.is_open()) log_fs << s;
-    };
+    logger = new log_writer(log_fs, MAX_LOG_LINES);
+
+    // open binary trace if specified
+    if (!trace_file.empty()) {
+        tracer = new trace_writer();
+        if (!tracer.load()->open(trace_file, geometry)) {
+            cerr << "Error: Could not open trace file " << trace_file << endl;
+            exit_handler();
+        }
+    }
+
+    // live stats segment if asked for
+    if (stats_interval_ns > 0 && !stats.open(geometry)) {
+        cerr << "Error: Could not create the stats segment" << endl;
+        exit_handler();
+    }
 
     // oss starting message
     {
@@ -406,16 +1267,35 @@ int main(int argc, char* argv[]) {
            << "-n: " << proc << endl
            << "-s: " << simul << endl
            << "-t: " << time_limit << endl
-           << "-i: " << launch_interval << endl;
-        oss_log(ss.str());
+           << "-i: " << launch_interval << endl
+           << "clock: " << (event_mode ? "event-driven" : "fixed ticks") << endl
+           << "receive: " << (drain_all ? "drain all pending, batched acks" : "one message per pass");
+        if (receivers > 0) ss << ", " << receivers << " receiver threads";
+        ss << endl
+           << "grant policy: " << (avoidance ? "banker's avoidance" : "grant if fits") << endl
+           << "queue order: " << grant_order->name() << endl
+           << "out-of-order requests: " << (split_reacquire ? "mass release, then request" : "one release-and-reacquire message") << endl
+           << "table dumps: " << (incremental_every > 0 ? "changed rows, full every " + to_string(incremental_every) : string("full")) << endl
+           << "live stats: " << (stats.is_open() ? "every " + to_string(stats_interval_ns / 1000000) + " ms for ossmon" : string("off")) << endl
+           << "workload: " << (workload_mode == "replay" ? "replayed from " + workload_path + " (" + to_string(replay_script.streams()) + " processes)"
+                               : (workload_mode == "record" ? "recorded to " + workload_path + ", " : string("")) + "seed " + to_string(run_seed)) << endl
+           << "event log: " << (tracer ? "binary trace " + trace_file : string("text")) << endl
+           << "workers: " << (pool ? "in-process" : prefork ? "prefork pool of " + to_string(prefork_pids.size()) + " ./worker" : string("forked ./worker")) << endl
+           << "transport: " << channel->name();
+        if (!pool) ss << " (" << wire_format << " wire format)";
+        ss << endl
+           << "resources: " << geometry.resources << " classes, instances " << geometry.instance_list()
+           << ", process table " << geometry.processes << " (" << resource_table->kind() << " descriptor)" << endl;
+        oss_log_msg(ss.str());
     }
 
     // set initial resource table state
-    resource_table.allocation_matrix.fill({0});
-    int total_requests = 0;
-    int total_mass_release = 0;
-    int total_resources_requested = 0;
-    int total_immediate_requests = 0;
+    // receiver threads update these too
+    atomic<int> total_requests{0};
+    atomic<int> total_mass_release{0};
+    atomic<int> total_exchanges{0};
+    atomic<int> total_resources_requested{0};
+    atomic<int> total_immediate_requests{0};
     int print_allo_table_interval = 0; 
 
     int launched_processes = 0;
@@ -424,29 +1304,235 @@ int main(int argc, char* argv[]) {
     long long launch_interval_nano = (long long)(launch_interval * 1e9); // convert launch interval to nanoseconds
     long long next_launch_total = 0; 
 
-    MessageBuffer rcvMessage;
-    MessageBuffer ackMessage;
+    deadlock_detector detector(geometry);
+    latency_stats latency(geometry.resources);
+    latency_histogram queued_wait_sim, queued_wait_wall; // wait of requests granted from the queue
+    long long deadlock_interval_nano = (long long)(deadlock_interval * 1e9);
+    long long next_deadlock_total = deadlock_interval_nano;
+
+    vector<MessageBuffer> batch;
+    vector<long long> batch_wall; // CLOCK_MONOTONIC arrival of each batch entry
+    size_t batch_limit = drain_all ? SIZE_MAX : 1;
+    long long loop_passes = 0, receive_passes = 0, received_messages = 0;
+    auto run_started = chrono::steady_clock::now();
+
+    // copy the scheduler's view into the stats segment, runs on the scheduler thread only
+    long long next_stats_wall = 0;
+    auto publish_stats = [&](bool done) {
+        stats_header *h = stats.begin_write();
+        h->done = done;
+        h->clock_ns = shm_clock->now();
+        h->queue_depth = process_queue.size();
+        h->counters.total_requests = total_requests;
+        h->counters.immediate_requests = total_immediate_requests;
+        h->counters.queued_requests = total_requests - total_immediate_requests;
+        h->counters.mass_releases = total_mass_release;
+        h->counters.exchanges = total_exchanges;
+        h->counters.resources_requested = total_resources_requested;
+        h->counters.launched = launched_processes;
+        h->counters.running = running_processes;
+        h->counters.deadlock_victims = detector.stats.victims;
+        resvec available = resource_table->available_vector();
+        memcpy(h->available, available.v, sizeof(h->available));
+        stats_pcb *pcbs = stats_pcbs(h);
+        res_t *allocation = stats_allocation(h);
+        for (int p = 0; p < geometry.processes; ++p) {
+            pcbs[p].occupied = table[p].occupied;
+            pcbs[p].pid = table[p].pid;
+            pcbs[p].start_ns = (long long)table[p].start_sec * NSEC_PER_SEC + table[p].start_nano;
+            resvec row = resource_table->row(p);
+            memcpy(allocation + (size_t)p * geometry.resources, row.v, sizeof(res_t) * geometry.resources);
+        }
+        stats.end_write();
+    };
+
+    event_queue events(EVENT_WORKERS + geometry.processes);
+    long long time_limit_nano = (long long)time_limit * NSEC_PER_SEC + seconds_conversion(time_limit);
+    long long launch_wall_ns = 0; // OSS wall time spent starting simulated processes
+    int doorbell_seen = 0;      // doorbell value read just before the last empty receive
+    bool last_poll_empty = false;
+    const struct timespec DOORBELL_TIMEOUT = {0, 10000000}; // 10ms safety net
+
+    // receiver threads (-X): requests that fit and every release are handled on the receiving thread,
+    // queueing, terminations and claims are handed to this one
+    vector<unique_ptr<receiver_state>> receiver_states;
+    vector<thread> receiver_threads;
+    auto receive_loop = [&](receiver_state &state) {
+        const struct timespec idle_wait = {0, 10000000};
+        MessageBuffer msg;
+        // never exit from here, the scheduler thread is still using everything exit would tear down
+        auto fail = [&](const char *what) {
+            perror(what);
+            receivers_failed = true;
+            receivers_stop = true;
+            futex_bump(&slot_tab->doorbell);
+        };
+        while (!receivers_stop.load()) {
+            int seen = slot_tab->doorbell.load();
+            int ret = channel->poll(msg);
+            if (ret == -1) {
+                fail("oss receive failed");
+                break;
+            }
+            if (ret == 0) {
+                futex_wait(&slot_tab->doorbell, seen, &idle_wait);
+                continue;
+            }
+            long long received_wall = monotonic_ns();
+            int pcb_index = (msg.process_running && !msg.declare_claim) ? find_pcb_by_pid(msg.pid) : -1;
+            if (pcb_index != -1 && msg.request_or_release == 1) {
+                resvec need = resvec_load<MAX_RESOURCES>(msg.resource_request);
+                int short_resource;
+                {
+                    trace_order order;
+                    if (msg.exchange == 1) {
+                        // the release and the request it makes room for are one table operation
+                        resvec amounts = resvec_load<MAX_RESOURCES>(msg.resource_release);
+                        short_resource = resource_table->try_exchange(pcb_index, amounts, need);
+                        total_exchanges++;
+                        released_by_receivers.fetch_or(resvec_nonzero_mask(amounts));
+                        trace_event(TRACE_EXCHANGE, msg.pid, pcb_index, &amounts);
+                        if (verbose_mode && !tracer) log_release(msg);
+                        // a request that has to wait goes to the scheduler thread as a plain request
+                        msg.exchange = 0;
+                        memset(msg.resource_release, 0, sizeof(msg.resource_release));
+                    } else {
+                        short_resource = resource_table->try_allocate(pcb_index, need);
+                    }
+                    if (short_resource == -1) trace_event(TRACE_GRANT, msg.pid, pcb_index, &need);
+                }
+                if (short_resource == -1) {
+                    total_requests++;
+                    total_resources_requested += resvec_sum(need);
+                    total_immediate_requests++;
+                    {
+                        lock_guard<mutex> hold(state.lock);
+                        state.latency.record(need, 0, monotonic_ns() - received_wall);
+                    }
+                    if (!tracer) log_grant(msg);
+                    state.handled++;
+                    slots[pcb_index].state = SLOT_BUSY;
+                    if (!channel->ack(pcb_index, msg.pid)) {
+                        fail("oss msgsnd ack failed");
+                        break;
+                    }
+                    continue;
+                }
+            } else if (pcb_index != -1) {
+                if (msg.mass_release == 1) total_mass_release++;
+                resvec amounts = resvec_load<MAX_RESOURCES>(msg.resource_release);
+                {
+                    trace_order order;
+                    resource_table->release(pcb_index, amounts);
+                    trace_event(msg.mass_release ? TRACE_MASS_RELEASE : TRACE_RELEASE, msg.pid, pcb_index, &amounts);
+                }
+                released_by_receivers.fetch_or(resvec_nonzero_mask(amounts));
+                if (verbose_mode && !tracer) log_release(msg);
+                state.handled++;
+                slots[pcb_index].state = SLOT_BUSY;
+                if (!channel->ack(pcb_index, msg.pid)) {
+                    fail("oss msgsnd ack failed");
+                    break;
+                }
+                continue;
+            }
+            handoffs.push(msg, received_wall);
+            state.handed_off++;
+            futex_bump(&slot_tab->doorbell);
+        }
+    };
+    // request -> grant latency recorded on this thread and every receiver
+    auto all_latency = [&]() {
+        latency_stats merged = latency;
+        for (unique_ptr<receiver_state> &st : receiver_states) {
+            lock_guard<mutex> hold(st->lock);
+            merged.merge(st->latency);
+        }
+        return merged;
+    };
+    if (receivers > 0) {
+        // signals stay with the scheduler thread
+        sigset_t all, old;
+        sigfillset(&all);
+        pthread_sigmask(SIG_BLOCK, &all, &old);
+        for (int i = 0; i < receivers; ++i) receiver_states.emplace_back(new receiver_state(geometry.resources));
+        for (unique_ptr<receiver_state> &st : receiver_states) receiver_threads.emplace_back(receive_loop, ref(*st));
+        pthread_sigmask(SIG_SETMASK, &old, nullptr);
+    }
+
+    // stop the receiver threads and wait for them, before anything they use is torn down
+    auto stop_receivers = [&]() {
+        receivers_stop = true;
+        futex_bump(&slot_tab->doorbell);
+        for (thread &t : receiver_threads) t.join();
+        receiver_threads.clear();
+    };
 
     while (launched_processes < proc || running_processes > 0) {
-        increment_clock(sec, nano, increment_amount);
+        if (stop_signal) {
+            stop_receivers();
+            shutdown_on_signal();
+        }
+        if (receivers_failed.load()) {
+            stop_receivers();
+            exit_handler();
+        }
+        if (!event_mode) {
+            increment_clock(increment_amount);
+        } else {
+            long long now = shm_clock->now();
+            if (workers_due(now)) {
+                // a worker is acting at this instant, hold the clock until it messages us or reschedules
+                // sleep on the doorbell unless something arrived since our last empty receive
+                if (last_poll_empty && !pool) futex_wait(&slot_tab->doorbell, doorbell_seen, &DOORBELL_TIMEOUT);
+            } else {
+                // refresh armed events and jump the clock straight to the earliest one
+                bool can_launch = launched_processes < proc && running_processes < simul && running_processes < geometry.processes && (time(nullptr) - start_time) < 5;
+                if (can_launch) events.arm(EVENT_LAUNCH, next_launch_total);
+                else events.disarm(EVENT_LAUNCH);
+                events.arm(EVENT_PRINT, next_print_total);
+                if (deadlock_interval_nano > 0) events.arm(EVENT_DEADLOCK, next_deadlock_total);
+                if (pool) {
+                    long long next_deadline = pool->next_deadline();
+                    if (next_deadline != -1) events.arm(EVENT_INPROC, next_deadline);
+                    else events.disarm(EVENT_INPROC);
+                } else {
+                    for (int i = 0; i < geometry.processes; ++i) {
+                        if (slots[i].state.load() == SLOT_SLEEPING) events.arm(EVENT_WORKERS + i, slots[i].deadline.load());
+                        else events.disarm(EVENT_WORKERS + i);
+                    }
+                }
+                long long target = events.next();
+                if (target > now) shm_clock->set(target);
+            }
+        }
+        wake_due_workers(shm_clock->now());
 
         // Check if it's time to launch a new worker
-        long long current_total = (long long)(*sec) * NSEC_PER_SEC + (long long)(*nano);
-        if (launched_processes < proc && running_processes < simul && running_processes < MAX_PROCESSES && current_total >= next_launch_total && (time(nullptr) - start_time) < 5) {
-            pid_t worker_pid = launch_worker(time_limit);
-
-            // Find empty slot in PCB array and populate it with new process info
+        long long current_total = shm_clock->now();
+        if (launched_processes < proc && running_processes < simul && running_processes < geometry.processes && current_total >= next_launch_total && (time(nullptr) - start_time) < 5) {
+            // Find empty slot in PCB array before launching so the worker knows its slot
             int pcb_index = find_empty_pcb(table);
             if (pcb_index == -1) {
-                // no free PCB slot found; avoid undefined behavior and kill the worker
-                cerr << "OSS: no free PCB slot available for new worker (pid=" << worker_pid << "). Killing worker." << endl;
-                kill(worker_pid, SIGTERM);
+                // no free PCB slot found; avoid undefined behavior and skip this launch
+                cerr << "OSS: no free PCB slot available for new worker. Skipping launch." << endl;
+            } else if (prefork && prefork_idle.empty()) {
+                cerr << "OSS: no idle pool worker available for new process. Skipping launch." << endl;
             } else {
-                table[pcb_index].occupied = true;
-                table[pcb_index].pid = worker_pid;
-                table[pcb_index].start_sec = *sec;
-                table[pcb_index].start_nano = *nano;
-                table[pcb_index].pcb_index = pcb_index;
+                // worker counts as busy until it publishes its first deadline
+                slots[pcb_index].deadline = 0;
+                slots[pcb_index].state = SLOT_BUSY;
+                last_woken[pcb_index] = -1;
+                channel->reset_slot(pcb_index);
+                auto launch_started = chrono::steady_clock::now();
+                pid_t worker_pid;
+                if (pool) worker_pid = pool->launch(pcb_index, time_limit_nano, derive_seed(run_seed, launched_processes), launched_processes);
+                else if (prefork) worker_pid = assign_prefork_member(pcb_index, time_limit_nano, launched_processes);
+                else worker_pid = launch_worker(time_limit, pcb_index, launched_processes);
+                launch_wall_ns += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - launch_started).count();
+
+                claim_pcb(table, pcb_index, worker_pid, current_total);
+                trace_event(TRACE_LAUNCH, worker_pid, pcb_index, nullptr);
 
                 launched_processes++;
                 running_processes++;
@@ -457,223 +1543,320 @@ int main(int argc, char* argv[]) {
             print_process_table(table, verbose_mode);
         }
 
-        // process queued requests: scan whole queue and allocate any request that can be satisfied
-        if (!process_queue.empty()) {
-            bool allocated_any;
-            do {
-                allocated_any = false;
-                for (size_t qi = 0; qi < process_queue.size(); ++qi) {
-                    MessageBuffer &queued_msg = process_queue[qi];
-                    int pcb_index = find_pcb_by_pid(queued_msg.pid);
-                    if (pcb_index == -1) {
-                        // PCB no longer exists; remove this queued message
-                        process_queue.erase(process_queue.begin() + qi);
-                        allocated_any = true; // restart scan
-                        break;
-                    }
+        // classes the receiver threads returned to the pool, waiters blocked on them get rechecked
+        if (receivers > 0) {
+            mark_released(released_by_receivers.exchange(0));
+        }
 
-                    bool can_allocate = true;
-                    for (int i = 0; i < MAX_RESOURCES; i++) {
-                        if (queued_msg.resource_request[i] > resource_table.available_resources[i]) {
-                            can_allocate = false;
-                            break;
-                        }
-                    }
-                    if (can_allocate) {
-                        // allocate resources
-                        for (int i = 0; i < MAX_RESOURCES; i++) {
-                            resource_table.available_resources[i] -= queued_msg.resource_request[i];
-                            resource_table.allocation_matrix[pcb_index][i] += queued_msg.resource_request[i];
-                        }
-                        {
-                            ostringstream ss;
-                            ss << "OSS: Allocated queued resources to worker " << queued_msg.pid << " ";
-                            for (int i = 0; i < MAX_RESOURCES; i++) {
-                                if (queued_msg.resource_request[i] > 0) ss << "R" << i << ":" << queued_msg.resource_request[i] << " ";
-                            }
-                            ss << "at time " << *sec << "s " << *nano << "ns" << endl;
-                            oss_log(ss.str());
-                        }
-                        // send ack message
-                        memset(&ackMessage, 0, sizeof(ackMessage));
-                        ackMessage.mtype = queued_msg.pid;
-                        ackMessage.process_running = 1;
-                        size_t ack_size = sizeof(MessageBuffer) - sizeof(long);
-                        if (msgsnd(msgid, &ackMessage, ack_size, 0) == -1) {
-                            perror("oss msgsnd ack failed");
-                            exit_handler();
-                        }
-                        // remove this entry and restart scanning
-                        process_queue.erase(process_queue.begin() + qi);
-                        allocated_any = true;
-                        break;
+        // process queued requests: only waiters blocked on a resource released since the last pass are rechecked
+        // granting never frees anything, so one pass in the policy's order grants everything that can be granted
+        if (process_queue.has_candidates()) {
+            vector<waiter> candidates = process_queue.take_candidates();
+            grant_order->order(candidates, shm_clock->now());
+            // strict order: nothing younger than a request left waiting may go
+            long long oldest_left = grant_order->strict() ? process_queue.oldest_seq() : -1;
+            bool blocked = false;
+            for (const waiter &w : candidates) {
+                const MessageBuffer &queued_msg = w.msg;
+                int pcb_index = find_pcb_by_pid(queued_msg.pid);
+                if (pcb_index == -1) continue; // PCB no longer exists; drop this queued message
+
+                if (grant_order->strict() && (blocked || (oldest_left != -1 && w.seq > oldest_left))) {
+                    blocked = true;
+                    process_queue.requeue(w, behind_bucket(w.need));
+                    continue;
+                }
+                trace_order order;
+                int short_resource = try_grant(pcb_index, w.need);
+                if (short_resource != -1) {
+                    // still blocked, file it under the resource it is now waiting on
+                    process_queue.requeue(w, short_resource);
+                    blocked = true;
+                    continue;
+                }
+                latency.record(w.need, shm_clock->now() - w.arrived_sim, monotonic_ns() - w.arrived_wall);
+                queued_wait_sim.record(shm_clock->now() - w.arrived_sim);
+                queued_wait_wall.record(monotonic_ns() - w.arrived_wall);
+                trace_event(TRACE_GRANT_QUEUED, queued_msg.pid, pcb_index, &w.need);
+                if (!tracer) {
+                    ostringstream ss;
+                    ss << "OSS: Allocated queued resources to worker " << queued_msg.pid << " ";
+                    for (int i = 0; i < geometry.resources; i++) {
+                        if (queued_msg.resource_request[i] > 0) ss << "R" << i << ":" << queued_msg.resource_request[i] << " ";
                     }
-                    // if cannot allocate, continue to next queued message
+                    ss << "at time " << shm_clock->sec() << "s " << shm_clock->nano() << "ns" << endl;
+                    oss_log_msg(ss.str());
                 }
-            } while (allocated_any && !process_queue.empty());
+                // acknowledged together with this pass's receive batch
+                queue_ack(pcb_index, queued_msg.pid);
+            }
         }
 
-        // non blocking message receive 
-        ssize_t msg_size = sizeof(MessageBuffer) - sizeof(long);
-        ssize_t ret = msgrcv(msgid, &rcvMessage, msg_size, getpid(), IPC_NOWAIT);
-        if (ret == -1) {
-            if (errno == ENOMSG) {
-                // no message available, continue
-            } else {
-                perror("msgrcv");
-                exit_handler();
-            }
+        // non blocking receive: one message per pass, or with -D every pending message
+        // with receiver threads only what they handed over arrives here
+        doorbell_seen = slot_tab->doorbell.load();
+        int ret;
+        if (receivers > 0) {
+            ret = handoffs.take(batch, batch_wall, batch_limit);
         } else {
+            ret = channel->poll_batch(batch, batch_limit);
+            batch_wall.assign(max(ret, 0), monotonic_ns());
+        }
+        last_poll_empty = (ret == 0);
+        if (ret == -1) {
+            perror("oss receive failed");
+            exit_handler();
+        }
+        loop_passes++;
+        if (ret > 0) {
+            receive_passes++;
+            received_messages += ret;
+        }
+        for (size_t m = 0; m < batch.size(); ++m) {
+            const MessageBuffer &rcvMessage = batch[m];
+            long long received_wall = batch_wall[m];
             if (rcvMessage.process_running == 0) {
                 // worker indicates it is terminating
-                {
+                if (!tracer) {
                     ostringstream ss;
                     ss << "OSS: Worker " << rcvMessage.pid << " indicates it is terminating. " << endl;
-                    oss_log(ss.str());
+                    oss_log_msg(ss.str());
                 }
                 int pcb_index = find_pcb_by_pid(rcvMessage.pid);
                 if (pcb_index != -1) {
                     // clean PCB entry
                     remove_pcb(table, rcvMessage.pid);
+                    retire_claim(pcb_index);
+                    slots[pcb_index].state = SLOT_EMPTY;
                     // release allocated resources add them back to available pool
-                    for (int i = 0; i < MAX_RESOURCES; i++) {
-                        resource_table.available_resources[i] += resource_table.allocation_matrix[pcb_index][i];
-                    }
-                    resource_table.allocation_matrix[pcb_index].fill(0); // clean allocation entry
+                    trace_order order;
+                    resvec held = resource_table->row(pcb_index);
+                    trace_event(TRACE_TERMINATE, rcvMessage.pid, pcb_index, &held);
+                    release_resources(pcb_index, held); // leaves the allocation entry clean
                 }
+                if (prefork) prefork_member_done(rcvMessage.pid, false);
                 running_processes--;
                 continue;
             }
+            if (rcvMessage.declare_claim == 1) {
+                // worker's maximum claim, only kept in avoidance mode and never acked
+                int pcb_index = find_pcb_by_pid(rcvMessage.pid);
+                resvec claim = resvec_load<MAX_RESOURCES>(rcvMessage.resource_request);
+                trace_event(TRACE_CLAIM, rcvMessage.pid, pcb_index, &claim);
+                if (avoidance && pcb_index != -1) avoidance->declare(pcb_index, claim);
+                continue;
+            }
+            // release-and-reacquire: the release goes back to the table but no waiter hears of it until
+            // the request below has been decided against it, as -X's try_exchange does under the shard locks,
+            // so no queued request can take the released instances first
+            resvec exchanged;
+            uint64_t exchanged_mask = 0;
+            if (rcvMessage.exchange == 1) {
+                total_exchanges++;
+                int pcb_index = find_pcb_by_pid(rcvMessage.pid);
+                exchanged = resvec_load<MAX_RESOURCES>(rcvMessage.resource_release);
+                if (pcb_index != -1) {
+                    resource_table->release(pcb_index, exchanged);
+                    exchanged_mask = resvec_nonzero_mask(exchanged);
+                }
+                trace_event(TRACE_EXCHANGE, rcvMessage.pid, pcb_index, &exchanged);
+                if (verbose_mode && !tracer) log_release(rcvMessage);
+            }
             // process resource requests/releases
             if (rcvMessage.request_or_release == 1) {
                 // update total requests and total resources requested
+                resvec need = resvec_load<MAX_RESOURCES>(rcvMessage.resource_request);
                 total_requests++;
-                for (int i = 0; i < MAX_RESOURCES; i++) {
-                    total_resources_requested += rcvMessage.resource_request[i];
-                }
+                total_resources_requested += resvec_sum(need);
 
                 // check if resources are available
+                trace_order order;
                 int pcb_index = find_pcb_by_pid(rcvMessage.pid);
-                if (pcb_index != -1) {
-                    bool can_allocate = true;
-                    for (int i = 0; i < MAX_RESOURCES; i++) {
-                        if (rcvMessage.resource_request[i] > resource_table.available_resources[i]) {
-                            can_allocate = false;
-                            break;
+                if (pcb_index != -1 && avoidance && !avoidance->within_claim(*resource_table, pcb_index, need)) {
+                    // safety is only proven against declared claims, a worker without one or past it has to go
+                    mark_released(exchanged_mask);
+                    if (!tracer) {
+                        ostringstream ss;
+                        ss << "OSS: Worker " << rcvMessage.pid << " requested beyond its maximum claim, terminating it, releasing ";
+                        for (int i = 0; i < geometry.resources; i++) {
+                            if (resource_table->allocated(pcb_index, i) > 0) ss << "R" << i << ":" << resource_table->allocated(pcb_index, i) << " ";
                         }
+                        ss << "at time " << shm_clock->sec() << "s " << shm_clock->nano() << "ns" << endl;
+                        oss_log_msg(ss.str());
                     }
-                    if (can_allocate) {
-                        // allocate resources
-                        for (int i = 0; i < MAX_RESOURCES; i++) {
-                            resource_table.available_resources[i] -= rcvMessage.resource_request[i];
-                            resource_table.allocation_matrix[pcb_index][i] += rcvMessage.resource_request[i];
+                    terminate_worker(pcb_index, rcvMessage.pid, TRACE_CLAIM_KILL);
+                    running_processes--;
+                    continue;
+                }
+                if (pcb_index != -1) {
+                    // a strict order lets nothing past the queue, and an order that does not grant on arrival
+                    // lets no arrival past queued requests that became grantable earlier in this batch: it waits
+                    // for the next pass and is granted in the policy's order together with them
+                    // an exchange is never held, it asks back what it just gave and nobody has heard of that yet
+                    bool hold = false;
+                    if (rcvMessage.exchange != 1) {
+                        hold = grant_order->strict() ? !process_queue.empty()
+                                                     : !grant_order->grants_on_arrival() && process_queue.has_candidates();
+                    }
+                    int short_resource = hold ? behind_bucket(need) : try_grant(pcb_index, need);
+                    if (exchanged_mask) {
+                        // waiters hear of the exchange's release now, only of what its request left free
+                        if (short_resource == -1) {
+                            uint64_t left = 0;
+                            for (uint64_t bits = exchanged_mask; bits; bits &= bits - 1) {
+                                int r = __builtin_ctzll(bits);
+                                if (exchanged[r] > need[r]) left |= 1ULL << r;
+                            }
+                            mark_released(left);
+                        } else {
+                            mark_released(exchanged_mask);
                         }
+                    }
+                    if (short_resource == -1) {
+                        latency.record(need, 0, monotonic_ns() - received_wall);
                     } else {
-                        {
-                            if (verbose_mode) {
-                                ostringstream ss;
-                                ss << "OSS: Resources not available for worker " << rcvMessage.pid << ", request queued." << " At time " << *sec << "s " << *nano << "ns" << endl;
-                                oss_log(ss.str());
-                            } else {
-                                cout << "OSS: Resources not available for worker " << rcvMessage.pid << ", request queued." << " At time " << *sec << "s " << *nano << "ns" << endl;
-                            }
+                        trace_event(TRACE_QUEUE, rcvMessage.pid, pcb_index, &need, short_resource);
+                        if (!tracer) {
+                            // only logged to the file in verbose mode
+                            ostringstream ss;
+                            ss << "OSS: " << queued_reason(short_resource) << " for worker " << rcvMessage.pid << ", request queued." << " At time " << shm_clock->sec() << "s " << shm_clock->nano() << "ns" << endl;
+                            oss_log_msg(ss.str(), verbose_mode);
                         }
-                        process_queue.push_back(rcvMessage);
+                        slots[pcb_index].state = SLOT_BLOCKED;
+                        process_queue.push(rcvMessage, need, short_resource, shm_clock->now(), received_wall);
+                        if (short_resource == WAIT_BEHIND && !grant_order->strict()) process_queue.held_back();
+                        detector.mark_dirty();
                         continue; // skip sending ack for now
                     }
                 }
-                {
-                    ostringstream ss;
-                    ss << "OSS: Resources allocated to worker " << rcvMessage.pid << " ";
-                    for (int i = 0; i < MAX_RESOURCES; i++) {
-                        if (rcvMessage.resource_request[i] > 0) ss << "R" << i << ":" << rcvMessage.resource_request[i] << " ";
-                    }
-                    ss << "at time " << *sec << "s " << *nano << "ns" << endl;
-                    ss << "OSS: available resources: ";
-                    for (int i = 0; i < MAX_RESOURCES; i++) {
-                        ss << "R" << i << ":" << resource_table.available_resources[i] << " ";
-                    }
-                    ss << endl;
-                    oss_log(ss.str());
-                }
+                trace_event(TRACE_GRANT, rcvMessage.pid, pcb_index, &need);
+                if (!tracer) log_grant(rcvMessage);
                 total_immediate_requests++;
                 if (++print_allo_table_interval >= 20 && verbose_mode) {
-                    print_allocation_matrix(resource_table.allocation_matrix, verbose_mode);
+                    print_allocation_matrix(*resource_table, verbose_mode);
                     print_allo_table_interval = 0;
                 }
-                // send message to worker acknowledging request
-                memset(&ackMessage, 0, sizeof(ackMessage));
-                ackMessage.mtype = rcvMessage.pid;
-                ackMessage.process_running = 1;
-                size_t ack_size = sizeof(MessageBuffer) - sizeof(long);
-                if (msgsnd(msgid, &ackMessage, ack_size, 0) == -1) {
-                    perror("oss msgsnd ack failed");
-                    exit_handler();
-                }
+                // acknowledge the request along with the rest of the pass
+                queue_ack(pcb_index, rcvMessage.pid);
             }
             if (rcvMessage.request_or_release == 0) {
                 if (rcvMessage.mass_release == 1) { total_mass_release++; }
                 // release resources back to the available pool
                 int pcb_index = find_pcb_by_pid(rcvMessage.pid);
+                resvec amounts = resvec_load<MAX_RESOURCES>(rcvMessage.resource_release);
+                trace_order order;
                 if (pcb_index != -1) {
-                    for (int i = 0; i < MAX_RESOURCES; i++) {
-                        resource_table.available_resources[i] += rcvMessage.resource_release[i];
-                        resource_table.allocation_matrix[pcb_index][i] -= rcvMessage.resource_release[i];
-                    }
-                }
-                {
-                    if (verbose_mode) {
-                        ostringstream ss;
-                        ss << "OSS: Resources released by worker " << rcvMessage.pid << " ";
-                        for (int i = 0; i < MAX_RESOURCES; i++) {
-                            if (rcvMessage.resource_release[i] > 0) ss << "R" << i << ":" << rcvMessage.resource_release[i] << " ";
-                        }
-                        ss << "at time " << *sec << "s " << *nano << "ns" << endl;
-                        ss << "OSS: available resources: ";
-                        for (int i = 0; i < MAX_RESOURCES; i++) {
-                            ss << "R" << i << ":" << resource_table.available_resources[i] << " ";
-                        }
-                        ss << endl;
-                        oss_log(ss.str());
-                    } else {
-                        
-                    }
-                }
-                // send message to worker acknowledging release
-                memset(&ackMessage, 0, sizeof(ackMessage));
-                ackMessage.mtype = rcvMessage.pid;
-                ackMessage.process_running = 1;
-                size_t ack_size = sizeof(MessageBuffer) - sizeof(long);
-                if (msgsnd(msgid, &ackMessage, ack_size, 0) == -1) {
-                    perror("oss msgsnd ack failed");
-                    exit_handler();
+                    release_resources(pcb_index, amounts);
                 }
+                trace_event(rcvMessage.mass_release ? TRACE_MASS_RELEASE : TRACE_RELEASE, rcvMessage.pid, pcb_index, &amounts);
+                if (verbose_mode && !tracer) log_release(rcvMessage);
+                // acknowledge the release along with the rest of the pass
+                queue_ack(pcb_index, rcvMessage.pid);
+            }
+        }
+        flush_acks();
+
+        // periodic deadlock check on the simulated clock
+        if (deadlock_interval_nano > 0 && shm_clock->now() >= next_deadlock_total) {
+            running_processes -= resolve_deadlocks(detector);
+            while (shm_clock->now() >= next_deadlock_total) next_deadlock_total += deadlock_interval_nano;
+        }
+
+        // republish the live stats on the wall clock, ossmon polls at its own rate
+        if (stats.is_open()) {
+            long long wall = monotonic_ns();
+            if (wall >= next_stats_wall) {
+                publish_stats(false);
+                next_stats_wall = wall + stats_interval_ns;
             }
         }
 
         // call print_process_table every half-second of simulated time
         {
-            long long current_total = (long long)(*sec) * NSEC_PER_SEC + (long long)(*nano);
+            long long current_total = shm_clock->now();
             while (current_total >= next_print_total) {
                 print_process_table(table, verbose_mode);
-                print_allocation_matrix(resource_table.allocation_matrix, verbose_mode);
+                print_allocation_matrix(*resource_table, verbose_mode);
+                if (receiver_states.empty()) print_latency(latency, false);
+                else print_latency(all_latency(), false);
                 next_print_total += PRINT_INTERVAL_NANO;
             }
         }
     }
 
+    // every simulated process is gone, stop the receivers
+    stop_receivers();
+    if (stats.is_open()) publish_stats(true);
+
     // ending report
+    long long run_wall_ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - run_started).count();
     ostringstream ss;
     ss << "ENDING REPORT" << endl;
     ss << "Total resources Requested: " << total_resources_requested << endl;
     ss << "Total requests: " << total_requests << endl;
     ss << "Times mass release was done: " << total_mass_release << endl;
+    ss << "Times release-and-reacquire was done: " << total_exchanges << endl;
     ss << "Percentage of request granted immediately vs amount of total requests: " << (total_immediate_requests * 100.0 / total_requests) << "%" << endl;
+    ss << "Deadlock detection: " << detector.stats.runs << " passes run, " << detector.stats.skipped << " checks skipped (nothing new blocked), "
+       << detector.stats.deadlocks << " deadlocks found, " << detector.stats.victims << " workers terminated" << endl;
+    ss << "Deadlock detection cost: " << detector.stats.processes_examined << " blocked processes examined, "
+       << detector.stats.rows_read << " held rows read, " << detector.stats.rows_reused << " kept from earlier passes, "
+       << detector.stats.rechecks << " vector rechecks, " << detector.stats.wall_ns / 1000 << " us wall time";
+    if (detector.stats.runs > 0) ss << " (" << detector.stats.wall_ns / detector.stats.runs << " ns per pass)";
+    ss << endl;
+    ss << "Receive: " << received_messages << " messages over " << receive_passes << " receiving passes ("
+       << (receive_passes > 0 ? (double)received_messages / receive_passes : 0.0) << " per pass), " << loop_passes << " loop passes" << endl;
+    if (receivers > 0) {
+        long long handled = 0, handed_off = 0;
+        for (unique_ptr<receiver_state> &st : receiver_states) {
+            handled += st->handled;
+            handed_off += st->handed_off;
+        }
+        ss << "Receiver threads: " << receivers << ", " << handled << " grants and releases handled on them, "
+           << handed_off << " messages handed to the scheduler thread" << endl;
+    }
+    ss << "Launches: " << launched_processes << ", " << (launched_processes > 0 ? launch_wall_ns / launched_processes : 0) << " ns OSS wall time per launch" << endl;
+    ss << "Grant policy: " << (avoidance ? "banker's avoidance" : "grant if fits") << ", "
+       << (run_wall_ns > 0 ? total_requests * 1e9 / run_wall_ns : 0.0) << " requests per wall second" << endl;
+    // wait of the requests granted from the queue, the number to compare -g policies on
+    ss << "Queue order: " << grant_order->name() << ", queued wait simulated ns: ";
+    print_percentiles(ss, queued_wait_sim, 1);
+    ss << " mean=" << queued_wait_sim.mean() << ", wall us: ";
+    print_percentiles(ss, queued_wait_wall, 1000);
+    ss << " mean=" << queued_wait_wall.mean() / 1000 << endl;
+    if (avoidance) {
+        const banker_stats &bs = avoidance->stats;
+        ss << "Safety checks: " << bs.checks << " run, " << bs.cache_hits << " settled by the cached safe sequence, "
+           << bs.full_runs << " full searches, " << bs.unsafe << " requests held back as unsafe, " << bs.violations << " workers terminated for requests beyond their claim" << endl;
+        ss << "Safety check cost: " << bs.wall_ns / 1000 << " us wall time";
+        if (bs.checks > 0) ss << " (" << bs.wall_ns / bs.checks << " ns per request, " << bs.max_ns << " ns max)";
+        ss << endl;
+    }
+    if (tracer) ss << "Trace: " << tracer.load()->count() << " event records written to " << trace_file << endl;
+    if (workload_mode == "record") {
+        // every worker is done appending, sort the streams into the replayable file
+        if (workload_record_finish(workload_path, geometry, avoidance_mode)) ss << "Workload: " << launched_processes << " process streams recorded to " << workload_path << endl;
+        else ss << "Workload: could not write " << workload_path << endl;
+    }
     oss_log_msg(ss.str());
+    if (receiver_states.empty()) print_latency(latency, true);
+    else print_latency(all_latency(), true);
+    logger->stop();
+    if (logger->dropped() > 0) cout << "Log file reached " << MAX_LOG_LINES << " lines, " << logger->dropped() << " lines not written to it" << endl;
 
     // cleanup
+     release_prefork_pool();
      shmdt(shm_clock);
      shmctl(shmid, IPC_RMID, nullptr);
-     msgctl(msgid, IPC_RMID, nullptr);
+     shmdt(slot_tab);
+     shmctl(slot_shmid, IPC_RMID, nullptr);
+     stats.remove();
+     channel->remove();
+     delete channel;
+     if (pool) delete[] slots;
+     delete avoidance;
+     delete grant_order;
+     delete logger;
+     close_trace();
      return 0;
  }
\ No newline at end of file
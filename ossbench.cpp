@@ -0,0 +1,237 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <climits>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+// run oss over a grid of parameters and append one CSV row per run, so builds can be compared
+
+// oss flags for each named mode, modes are combined with '+' (e.g. event+ring)
+struct bench_mode {
+    const char *name;
+    vector<string> flags;
+};
+static const bench_mode MODES[] = {
+    {"ticks", {}},
+    {"event", {"-e"}},
+    {"ring", {"-T", "ring"}},
+    {"legacy", {"-W", "legacy"}},
+    {"drain", {"-D"}},
+    {"threads", {"-X", "4"}},
+    {"incremental", {"-u", "10"}},
+    {"banker", {"-b"}},
+    {"fifo", {"-g", "fifo"}},
+    {"smallest", {"-g", "smallest"}},
+    {"aging", {"-g", "aging"}},
+    {"split", {"-x"}},
+    {"pool", {"-w", "pool"}},
+    {"inproc", {"-w", "inproc"}},
+};
+
+// numbers the ending report prints, -1 when a line is missing (oss failed or was cut short)
+struct bench_result {
+    int status = -1;
+    double wall_s = 0, user_s = 0, sys_s = 0;
+    long long requests = -1;
+    long long sim[4] = {-1, -1, -1, -1};  // p50 p90 p99 max, simulated ns
+    long long wall[4] = {-1, -1, -1, -1}; // p50 p90 p99 max, wall us
+};
+
+static vector<string> split(const string &s, char sep) {
+    vector<string> out;
+    stringstream ss(s);
+    string item;
+    while (getline(ss, item, sep)) if (!item.empty()) out.push_back(item);
+    return out;
+}
+
+// append the flags for a '+' separated mode, false if a part is not a known mode
+static bool mode_flags(const string &mode, vector<string> &args) {
+    for (const string &part : split(mode, '+')) {
+        bool found = false;
+        for (const bench_mode &m : MODES) {
+            if (part == m.name) {
+                args.insert(args.end(), m.flags.begin(), m.flags.end());
+                found = true;
+            }
+        }
+        if (!found) return false;
+    }
+    return true;
+}
+
+// "p50=12 p90=..." fields after prefix on the line starting with it
+static void parse_percentiles(const string &out, const string &prefix, long long *into) {
+    size_t at = out.find(prefix);
+    if (at == string::npos) return;
+    string line = out.substr(at, out.find('\n', at) - at);
+    const char *keys[] = {"p50=", "p90=", "p99=", "max="};
+    for (int k = 0; k < 4; ++k) {
+        size_t p = line.find(keys[k]);
+        if (p != string::npos) into[k] = atoll(line.c_str() + p + 4);
+    }
+}
+
+// run ./oss once with args, collecting its output and resource usage
+static bench_result run_oss(const vector<string> &args) {
+    bench_result r;
+    int pipefd[2];
+    if (pipe(pipefd) == -1) {
+        perror("pipe");
+        return r;
+    }
+    auto started = chrono::steady_clock::now();
+    pid_t pid = fork();
+    if (pid < 0) {
+        perror("fork");
+        return r;
+    }
+    if (pid == 0) {
+        // oss and its workers all write to the pipe
+        dup2(pipefd[1], STDOUT_FILENO);
+        close(pipefd[0]);
+        close(pipefd[1]);
+        vector<char*> argv;
+        argv.push_back((char*)"./oss");
+        for (const string &a : args) argv.push_back(const_cast<char*>(a.c_str()));
+        argv.push_back(nullptr);
+        execv(argv[0], argv.data());
+        cerr << "ossbench: exec ./oss failed" << endl;
+        exit(127);
+    }
+    close(pipefd[1]);
+    string out;
+    char buf[65536];
+    ssize_t n;
+    while ((n = read(pipefd[0], buf, sizeof(buf))) > 0) out.append(buf, n);
+    close(pipefd[0]);
+
+    int status;
+    struct rusage ru;
+    if (wait4(pid, &status, 0, &ru) == -1) {
+        perror("wait4");
+        return r;
+    }
+    r.wall_s = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+    r.status = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    r.user_s = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6;
+    r.sys_s = ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+
+    size_t at = out.find("Total requests: ");
+    if (at != string::npos) r.requests = atoll(out.c_str() + at + strlen("Total requests: "));
+    parse_percentiles(out, "Request->grant latency, simulated ns:", r.sim);
+    parse_percentiles(out, "Request->grant latency, wall us:", r.wall);
+    return r;
+}
+
+static void usage() {
+    // listed from MODES so the help never drifts from what is accepted
+    string modes;
+    for (const bench_mode &m : MODES) modes += string(modes.empty() ? "" : ", ") + m.name;
+    cerr << "Usage: ossbench [-n list] [-s list] [-t list] [-i list] [-m list] [-r runs] [-S seed] [-l label] [-o results.csv]\n"
+         << "  -n/-s/-t/-i list  Comma separated values for the oss option of the same name (default -n 20 -s 5,18 -t 1 -i 0.05,0.2)\n"
+         << "  -m list           Comma separated modes, join modes with '+' (" << modes << ")\n"
+         << "                    (default ticks,event,event+ring)\n"
+         << "  -r runs           Runs of every combination (default 1)\n"
+         << "  -S seed           Run k of every combination uses oss -S seed+k-1, so every mode sees the same workloads\n"
+         << "  -l label          Build label written on every row (default local)\n"
+         << "  -o file           Results file, rows are appended under a header (default bench_results.csv)\n"
+         << "Example:\n"
+         << "  ./ossbench -n 20,40 -s 5,18 -t 1 -i 0.05,0.2 -m ticks,event+ring -r 3 -l baseline" << endl;
+}
+
+// optarg parsed whole and within [min, max], as oss does: "abc" or "3x" is a usage error instead of a 0 or a truncated value
+static long long integer_arg(int opt, const char *s, long long min, long long max, const char *what) {
+    try {
+        size_t used = 0;
+        long long v = stoll(s, &used);
+        if (used == strlen(s) && v >= min && v <= max) return v;
+    } catch (...) {}
+    cerr << "Error: -" << (char) opt << " must be " << what << "." << endl;
+    exit(1);
+}
+
+int main(int argc, char* argv[]) {
+    vector<string> n_list = {"20"}, s_list = {"5", "18"}, t_list = {"1"}, i_list = {"0.05", "0.2"};
+    vector<string> mode_list = {"ticks", "event", "event+ring"};
+    int runs = 1;
+    string label = "local";
+    string results_file = "bench_results.csv";
+    long long seed = -1;
+    int opt;
+    while ((opt = getopt(argc, argv, "hn:s:t:i:m:r:S:l:o:")) != -1) {
+        switch (opt) {
+            case 'n': n_list = split(optarg, ','); break;
+            case 's': s_list = split(optarg, ','); break;
+            case 't': t_list = split(optarg, ','); break;
+            case 'i': i_list = split(optarg, ','); break;
+            case 'm': mode_list = split(optarg, ','); break;
+            case 'r': runs = (int) integer_arg(opt, optarg, 1, INT_MAX, "a positive integer"); break;
+            case 'S': seed = integer_arg(opt, optarg, 0, LLONG_MAX, "a non-negative integer"); break;
+            case 'l': label = optarg; break;
+            case 'o': results_file = optarg; break;
+            default:
+                usage();
+                exit(opt == 'h' ? 0 : 1);
+        }
+    }
+    if (runs < 1 || n_list.empty() || s_list.empty() || t_list.empty() || i_list.empty() || mode_list.empty()) {
+        usage();
+        exit(1);
+    }
+    for (const string &mode : mode_list) {
+        vector<string> check;
+        if (!mode_flags(mode, check)) {
+            cerr << "ossbench: unknown mode " << mode << endl;
+            exit(1);
+        }
+    }
+
+    struct stat st;
+    bool write_header = stat(results_file.c_str(), &st) != 0 || st.st_size == 0;
+    ofstream results(results_file, ios::app);
+    if (!results) {
+        cerr << "ossbench: could not open " << results_file << endl;
+        exit(1);
+    }
+    if (write_header) {
+        results << "label,n,s,t,i,mode,run,exit,wall_s,user_s,sys_s,requests,requests_per_s,"
+                << "sim_p50_ns,sim_p90_ns,sim_p99_ns,sim_max_ns,wall_p50_us,wall_p90_us,wall_p99_us,wall_max_us" << endl;
+    }
+
+    for (const string &n : n_list)
+    for (const string &s : s_list)
+    for (const string &t : t_list)
+    for (const string &i : i_list)
+    for (const string &mode : mode_list)
+    for (int run = 1; run <= runs; ++run) {
+        vector<string> args = {"-n", n, "-s", s, "-t", t, "-i", i};
+        mode_flags(mode, args);
+        if (seed >= 0) {
+            args.push_back("-S");
+            args.push_back(to_string(seed + run - 1));
+        }
+        bench_result r = run_oss(args);
+        double rps = (r.requests > 0 && r.wall_s > 0) ? r.requests / r.wall_s : 0.0;
+        results << label << "," << n << "," << s << "," << t << "," << i << "," << mode << "," << run << ","
+                << r.status << "," << r.wall_s << "," << r.user_s << "," << r.sys_s << "," << r.requests << "," << rps;
+        for (long long v : r.sim) results << "," << v;
+        for (long long v : r.wall) results << "," << v;
+        results << endl;
+        cout << "ossbench: -n " << n << " -s " << s << " -t " << t << " -i " << i << " " << mode << " run " << run
+             << ": " << r.wall_s << "s wall, " << r.user_s + r.sys_s << "s cpu, " << rps << " requests/s, grant p99 "
+             << r.wall[2] << "us" << (r.status != 0 ? " (oss exit " + to_string(r.status) + ")" : "") << endl;
+    }
+    return 0;
+}
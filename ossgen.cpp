@@ -0,0 +1,256 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <queue>
+#include <random>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include "resources.h"
+#include "simclock.h"
+#include "workload.h"
+
+using namespace std;
+
+// generate a workload script for oss -L: one stream of timed requests and releases per process
+//
+// requests arrive at random (optionally in bursts), pick a class by a Zipf popularity so a few
+// classes run hot, and each grant is released again after a holding time that is exponential or,
+// with -H, Pareto distributed so a few holds last far longer than the rest
+
+struct gen_params {
+    int processes = 20;
+    double lifetime_s = 2.0;
+    double gap_ms = 50.0;
+    int burst = 1;
+    double hold_ms = 200.0;
+    double pareto_alpha = 0.0; // 0: exponential holding times
+    double zipf_s = 0.0;       // 0: every class equally popular
+    int max_amount = 2;
+    bool claims = false;
+};
+
+struct pending_release {
+    long long at;
+    int resource;
+    int amount;
+    bool operator>(const pending_release &o) const { return at > o.at; }
+};
+
+static void emit(vector<workload_op> &ops, int op, int resource, long long value) {
+    workload_op o;
+    o.op = (uint8_t) op;
+    o.resource = (uint8_t) resource;
+    o.pad = 0;
+    o.value = (int32_t) value;
+    ops.push_back(o);
+}
+
+// wait ns, split so every wait fits its 32-bit value
+static void emit_wait(vector<workload_op> &ops, long long ns) {
+    if (ns < 1) ns = 1;
+    while (ns > 0) {
+        long long chunk = min(ns, (long long) INT32_MAX);
+        emit(ops, WL_WAIT, 0, chunk);
+        ns -= chunk;
+    }
+}
+
+static void generate_stream(const gen_params &p, const resource_geometry &g, mt19937_64 &rng, vector<workload_op> &out) {
+    long long lifetime = (long long) (p.lifetime_s * NSEC_PER_SEC);
+    long long mean_gap = (long long) (p.gap_ms * 1e6);
+    double mean_hold = p.hold_ms * 1e6;
+    exponential_distribution<double> between_bursts(1.0 / max(1.0, (double) mean_gap * p.burst));
+    exponential_distribution<double> exp_hold(1.0 / max(1.0, mean_hold));
+    uniform_real_distribution<double> unit(0.0, 1.0);
+    const long long IN_BURST_GAP = 1000000; // 1ms between the requests of a burst
+
+    vector<double> weight(g.resources);
+    for (int r = 0; r < g.resources; ++r) weight[r] = 1.0 / pow(r + 1, p.zipf_s);
+
+    int held[MAX_RESOURCES] = {0};
+    int peak[MAX_RESOURCES] = {0};
+    priority_queue<pending_release, vector<pending_release>, greater<pending_release>> releases;
+    vector<workload_op> ops;
+    long long now = 0;
+    long long next_request = (long long) between_bursts(rng);
+    int burst_left = p.burst;
+
+    while (true) {
+        bool is_release = !releases.empty() && releases.top().at <= next_request;
+        long long at = is_release ? releases.top().at : next_request;
+        if (at >= lifetime) break;
+        emit_wait(ops, at - now);
+        now = at;
+        if (is_release) {
+            pending_release rel = releases.top();
+            releases.pop();
+            emit(ops, WL_RELEASE, rel.resource, rel.amount);
+            held[rel.resource] -= rel.amount;
+            continue;
+        }
+
+        // next arrival: the rest of this burst close behind, else a gap before the next burst
+        if (--burst_left > 0) {
+            next_request = now + IN_BURST_GAP;
+        } else {
+            burst_left = p.burst;
+            next_request = now + max(1LL, (long long) between_bursts(rng));
+        }
+
+        // pick a class with room by popularity
+        double total = 0;
+        for (int r = 0; r < g.resources; ++r) if (held[r] < g.instances[r]) total += weight[r];
+        if (total <= 0) {
+            emit(ops, WL_IDLE, 0, 0);
+            continue;
+        }
+        double pick = unit(rng) * total;
+        int resource = -1;
+        for (int r = 0; r < g.resources; ++r) {
+            if (held[r] >= g.instances[r]) continue;
+            resource = r;
+            pick -= weight[r];
+            if (pick <= 0) break;
+        }
+        uniform_int_distribution<int> amount_dis(1, min(p.max_amount, g.instances[resource] - held[resource]));
+        int amount = amount_dis(rng);
+        emit(ops, WL_REQUEST, resource, amount);
+        held[resource] += amount;
+        peak[resource] = max(peak[resource], held[resource]);
+
+        double hold;
+        if (p.pareto_alpha > 0) {
+            // Pareto with the same mean as the exponential, scale x_m = mean * (alpha - 1) / alpha
+            double xm = mean_hold * (p.pareto_alpha - 1) / p.pareto_alpha;
+            hold = xm / pow(1.0 - unit(rng), 1.0 / p.pareto_alpha);
+        } else {
+            hold = exp_hold(rng);
+        }
+        releases.push({now + max(1LL, (long long) min(hold, 1e15)), resource, amount});
+    }
+    emit_wait(ops, lifetime - now);
+    emit(ops, WL_TERMINATE, 0, 0);
+
+    // claims go first: the most the script ever holds of each class, at least one instance of something
+    if (p.claims) {
+        bool any = false;
+        for (int r = 0; r < g.resources; ++r) any = any || peak[r] > 0;
+        if (!any) peak[0] = 1;
+        for (int r = 0; r < g.resources; ++r) emit(out, WL_CLAIM, r, peak[r]);
+    }
+    emit(out, WL_START, 0, max(1LL, mean_gap));
+    out.insert(out.end(), ops.begin(), ops.end());
+}
+
+static void usage() {
+    cerr << "Usage: ossgen [-n processes] [-t seconds] [-g gap_ms] [-u burst] [-d hold_ms] [-H alpha] [-z s] [-a amount]\n"
+         << "              [-R count] [-I instances] [-b] [-S seed] [-o file]\n"
+         << "  -n processes  Streams to generate, one per launched process (default 20)\n"
+         << "  -t seconds    Simulated lifetime of each process, its stream ends with a terminate (default 2)\n"
+         << "  -g gap_ms     Mean simulated ms between requests (default 50)\n"
+         << "  -u burst      Requests arrive in bursts of this many, 1ms apart (default 1, no bursts)\n"
+         << "  -d hold_ms    Mean simulated ms a grant is held before it is released (default 200)\n"
+         << "  -H alpha      Pareto holding times with shape alpha > 1 instead of exponential (heavy tail)\n"
+         << "  -z s          Zipf exponent of class popularity, class 0 hottest (default 0, uniform)\n"
+         << "  -a amount     Most instances per request (default 2)\n"
+         << "  -R/-I         Resource geometry, as for oss (default " << DEFAULT_RESOURCES << " classes of " << MAX_INSTANCES << ")\n"
+         << "  -b            Start every stream with a claim, for oss -b\n"
+         << "  -S seed       Random seed (default random)\n"
+         << "  -o file       Output script (default workload.bin)\n"
+         << "Example:\n"
+         << "  ./ossgen -n 40 -u 4 -H 1.5 -z 1.2 -o hot.bin && ./oss -n 40 -s 10 -t 3 -i 0.1 -L hot.bin" << endl;
+}
+
+// optarg parsed whole, as oss does: "abc" or "1.5x" is a usage error instead of a 0 or a truncated value
+static int int_arg(int opt, const char *s) {
+    try {
+        size_t used = 0;
+        int v = stoi(s, &used);
+        if (used == strlen(s)) return v;
+    } catch (...) {}
+    cerr << "Error: -" << (char) opt << " must be an integer." << endl;
+    exit(1);
+}
+
+static double number_arg(int opt, const char *s) {
+    try {
+        size_t used = 0;
+        double v = stod(s, &used);
+        if (used == strlen(s)) return v;
+    } catch (...) {}
+    cerr << "Error: -" << (char) opt << " must be a number." << endl;
+    exit(1);
+}
+
+static uint64_t seed_arg(int opt, const char *s) {
+    try {
+        size_t used = 0;
+        uint64_t v = stoull(s, &used);
+        if (used == strlen(s) && s[0] != '-') return v;
+    } catch (...) {}
+    cerr << "Error: -" << (char) opt << " must be a non-negative integer." << endl;
+    exit(1);
+}
+
+int main(int argc, char* argv[]) {
+    gen_params p;
+    resource_geometry g;
+    string instance_arg;
+    bool resources_given = false;
+    uint64_t seed = random_device{}();
+    string out_file = "workload.bin";
+    int opt;
+    while ((opt = getopt(argc, argv, "hn:t:g:u:d:H:z:a:R:I:bS:o:")) != -1) {
+        switch (opt) {
+            case 'n': p.processes = int_arg(opt, optarg); break;
+            case 't': p.lifetime_s = number_arg(opt, optarg); break;
+            case 'g': p.gap_ms = number_arg(opt, optarg); break;
+            case 'u': p.burst = int_arg(opt, optarg); break;
+            case 'd': p.hold_ms = number_arg(opt, optarg); break;
+            case 'H': p.pareto_alpha = number_arg(opt, optarg); break;
+            case 'z': p.zipf_s = number_arg(opt, optarg); break;
+            case 'a': p.max_amount = int_arg(opt, optarg); break;
+            case 'R':
+                g.resources = int_arg(opt, optarg);
+                resources_given = true;
+                break;
+            case 'I': instance_arg = optarg; break;
+            case 'b': p.claims = true; break;
+            case 'S': seed = seed_arg(opt, optarg); break;
+            case 'o': out_file = optarg; break;
+            default:
+                usage();
+                exit(opt == 'h' ? 0 : 1);
+        }
+    }
+    if (p.processes < 0 || p.lifetime_s <= 0 || p.gap_ms <= 0 || p.burst < 1 || p.hold_ms <= 0 || p.max_amount < 1
+        || (p.pareto_alpha != 0 && p.pareto_alpha <= 1) || p.zipf_s < 0 || g.resources < 1 || g.resources > MAX_RESOURCES) {
+        cerr << "Error: invalid parameters (-H needs alpha > 1)." << endl;
+        usage();
+        exit(1);
+    }
+    if (!instance_arg.empty()) {
+        int requested = g.resources;
+        if (!g.parse_instances(instance_arg) || (resources_given && g.resources != requested)) {
+            cerr << "Error: bad -I instance list." << endl;
+            exit(1);
+        }
+    }
+
+    mt19937_64 rng(seed);
+    vector<int64_t> offsets = {0};
+    vector<workload_op> ops;
+    for (int i = 0; i < p.processes; ++i) {
+        generate_stream(p, g, rng, ops);
+        offsets.push_back((int64_t) ops.size());
+    }
+    if (!workload_write(out_file, g.resources, p.claims, offsets, ops)) {
+        cerr << "Error: could not write " << out_file << endl;
+        exit(1);
+    }
+    cout << "Wrote " << p.processes << " process streams, " << ops.size() << " ops (" << ops.size() * sizeof(workload_op)
+         << " bytes) to " << out_file << ", seed " << seed << endl;
+    return 0;
+}
@@ -0,0 +1,126 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cerrno>
+#include <csignal>
+#include <unistd.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include "resources.h"
+#include "simclock.h"
+#include "statseg.h"
+
+using namespace std;
+
+// attach read-only to the stats segment of an oss run started with -M and render it
+// every refresh_ms, without OSS logging or formatting anything
+
+static void render(stats_header *h, bool all_rows, bool clear) {
+    const stats_counters &c = h->counters;
+    ostringstream ss;
+    if (clear) ss << "\033[H\033[2J";
+    ss << "OSS " << h->oss_pid << (h->done ? " (finished)" : "") << ", clock " << clock_sec(h->clock_ns) << "s "
+       << clock_nano(h->clock_ns) << "ns, snapshot " << h->publishes << endl;
+    ss << "Processes: " << c.launched << " launched, " << c.running << " running, " << c.deadlock_victims << " deadlock victims" << endl;
+    ss << "Requests: " << c.total_requests << " total, " << c.immediate_requests << " granted immediately, "
+       << c.queued_requests << " queued, " << h->queue_depth << " waiting now, " << c.mass_releases << " mass releases, "
+       << c.exchanges << " release-and-reacquires, "
+       << c.resources_requested << " instances requested" << endl;
+    ss << "Available: ";
+    for (int r = 0; r < h->resources; ++r) ss << "R" << r << ":" << h->available[r] << " ";
+    ss << endl << endl;
+
+    ss << left << setw(8) << "Index" << setw(10) << "PID" << setw(14) << "Start";
+    for (int r = 0; r < h->resources; ++r) ss << right << setw(6) << "R" + to_string(r);
+    ss << endl;
+    stats_pcb *pcbs = stats_pcbs(h);
+    res_t *allocation = stats_allocation(h);
+    for (int p = 0; p < h->processes; ++p) {
+        if (!pcbs[p].occupied && !all_rows) continue;
+        ss << left << setw(8) << p;
+        if (pcbs[p].occupied) {
+            ostringstream start;
+            start << clock_sec(pcbs[p].start_ns) << "." << setw(9) << setfill('0') << right << clock_nano(pcbs[p].start_ns);
+            ss << setw(10) << pcbs[p].pid << left << setw(14) << start.str();
+        } else {
+            ss << setw(10) << "-" << setw(14) << "-";
+        }
+        for (int r = 0; r < h->resources; ++r) ss << right << setw(6) << allocation[(size_t)p * h->resources + r];
+        ss << endl;
+    }
+    cout << ss.str() << flush;
+}
+
+int main(int argc, char* argv[]) {
+    int refresh_ms = 500;
+    long long count = 0;
+    bool all_rows = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "hr:c:a")) != -1) {
+        switch (opt) {
+            case 'r':
+                refresh_ms = atoi(optarg);
+                if (refresh_ms < 1) {
+                    cerr << "Error: -r must be a positive number of milliseconds." << endl;
+                    exit(1);
+                }
+                break;
+            case 'c':
+                count = atoll(optarg);
+                break;
+            case 'a':
+                all_rows = true;
+                break;
+            default:
+                cerr << "Usage: ossmon [-r refresh_ms] [-c count] [-a]\n"
+                     << "  -r refresh_ms   Milliseconds between refreshes (default 500)\n"
+                     << "  -c count        Stop after count refreshes (default: until OSS finishes)\n"
+                     << "  -a              Show every process table row, not only occupied ones\n"
+                     << "Run from the directory oss was started in, with oss running under -M." << endl;
+                exit(opt == 'h' ? 0 : 1);
+        }
+    }
+
+    int shmid = shmget(ftok("oss.cpp", 4), 0, 0);
+    if (shmid == -1) {
+        cerr << "Error: no stats segment found, start oss with -M" << endl;
+        exit(1);
+    }
+    struct shmid_ds info;
+    if (shmctl(shmid, IPC_STAT, &info) == -1) {
+        perror("shmctl");
+        exit(1);
+    }
+    size_t bytes = info.shm_segsz;
+    void *p = shmat(shmid, nullptr, SHM_RDONLY);
+    if (p == (void*) -1) {
+        perror("shmat");
+        exit(1);
+    }
+    stats_header *live = (stats_header*) p;
+    if (bytes < sizeof(stats_header) || live->magic != STATS_MAGIC || live->version != STATS_VERSION) {
+        cerr << "Error: stats segment is not from this version of oss" << endl;
+        exit(1);
+    }
+
+    bool clear = isatty(STDOUT_FILENO);
+    vector<char> copy;
+    for (long long shown = 0; count == 0 || shown < count; ++shown) {
+        if (!stats_snapshot(live, bytes, copy)) {
+            usleep(1000);
+            continue;
+        }
+        stats_header *h = (stats_header*) copy.data();
+        render(h, all_rows, clear);
+        if (h->done) break;
+        if (kill(h->oss_pid, 0) == -1 && errno == ESRCH) {
+            cout << "OSS " << h->oss_pid << " exited without a final snapshot" << endl;
+            break;
+        }
+        usleep(refresh_ms * 1000);
+    }
+    shmdt(p);
+    return 0;
+}
@@ -2,14 +2,207 @@
 #define RESOURCES_H
 
 #include <array>
+#include <vector>
+#include <string>
+#include <sstream>
+#include "resvec.h"
 
-#define MAX_RESOURCES 10
+// compile-time capacities, a run uses any geometry up to these
+#define MAX_RESOURCES 64
+#define MAX_PROCESSES 256
+
+// default geometry when OSS is not given -R/-I/-P
+#define DEFAULT_RESOURCES 10
 #define MAX_INSTANCES 5
-#define MAX_PROCESSES 18
+#define DEFAULT_PROCESSES 18
+
+// request/release vector wide enough for any geometry, classes past the run's count stay zero
+typedef basic_resvec<MAX_RESOURCES> resvec;
+
+// resource mix for one run, chosen by OSS and passed to every worker
+struct resource_geometry {
+    int resources = DEFAULT_RESOURCES;    // resource classes in use
+    int processes = DEFAULT_PROCESSES;    // process table size
+    int instances[MAX_RESOURCES] = {0};   // total instances of each class
+
+    resource_geometry() {
+        for (int i = 0; i < MAX_RESOURCES; ++i) instances[i] = MAX_INSTANCES;
+    }
+
+    // comma separated instance counts, e.g. "5,5,8", as passed on the worker command line
+    std::string instance_list() const {
+        std::string s;
+        for (int i = 0; i < resources; ++i) s += (i ? "," : "") + std::to_string(instances[i]);
+        return s;
+    }
+
+    // fill instances from "n" (every class) or "n1,n2,..." (one per class), false if malformed
+    bool parse_instances(const std::string &list) {
+        std::vector<int> counts;
+        std::stringstream ss(list);
+        std::string item;
+        while (getline(ss, item, ',')) {
+            try {
+                size_t used = 0;
+                int val = std::stoi(item, &used);
+                if (used != item.size() || val <= 0 || val > 32767) return false;
+                counts.push_back(val);
+            } catch (...) {
+                return false;
+            }
+        }
+        if (counts.empty() || counts.size() > MAX_RESOURCES) return false;
+        for (int i = 0; i < MAX_RESOURCES; ++i) {
+            instances[i] = (counts.size() == 1) ? counts[0] : (i < (int)counts.size() ? counts[i] : 0);
+        }
+        if (counts.size() > 1) resources = (int)counts.size();
+        return true;
+    }
+};
 
-struct resource_descriptor {
-    std::array<int, MAX_RESOURCES> available_resources = {5, 5, 5, 5, 5, 5, 5, 5, 5, 5};
-    std::array<std::array<int, MAX_RESOURCES>, MAX_PROCESSES> allocation_matrix = {};
+// the available vector and allocation matrix, behind an interface so OSS can run on
+// a compile-time sized descriptor for common geometries and a dynamic one otherwise
+class resource_descriptor_base {
+public:
+    virtual ~resource_descriptor_base() {}
+    virtual const char* kind() const = 0;
+    virtual int num_resources() const = 0;
+    virtual int num_processes() const = 0;
+
+    virtual int available(int r) const = 0;
+    virtual int allocated(int p, int r) const = 0;
+    // available pool widened to a request vector
+    virtual resvec available_vector() const = 0;
+    // allocation row of process p widened to a request vector
+    virtual resvec row(int p) const = 0;
+
+    // index of the first class request needs more of than is available, -1 if it fits
+    virtual int first_short(const resvec &request) const = 0;
+    // move instances from the available pool into p's allocation row
+    virtual void allocate(int p, const resvec &amounts) = 0;
+    // allocate request to p if it fits: -1 if it was allocated, else the first class it is short of
+    virtual int try_allocate(int p, const resvec &request) {
+        int short_resource = first_short(request);
+        if (short_resource == -1) allocate(p, request);
+        return short_resource;
+    }
+    // move instances from p's allocation row back to the available pool
+    virtual void release(int p, const resvec &amounts) = 0;
+    // release released from p, then allocate request to p if it fits, with nothing in between:
+    // -1 if it was allocated, else the first class it is short of, released is given back either way
+    virtual int try_exchange(int p, const resvec &released, const resvec &request) {
+        release(p, released);
+        return try_allocate(p, request);
+    }
 };
 
-#endif
\ No newline at end of file
+// descriptor sized at compile time for up to R classes and P processes, every kernel runs
+// over a constant lane count so it unrolls completely
+template <int R, int P>
+class resource_descriptor : public resource_descriptor_base {
+    static const int LANES = basic_resvec<R>::LANES;
+    int resources;
+    int processes;
+public:
+    basic_resvec<R> available_resources;
+    std::array<basic_resvec<R>, P> allocation_matrix;
+
+    explicit resource_descriptor(const resource_geometry &g) : resources(g.resources), processes(g.processes) {
+        available_resources.fill(0);
+        for (int i = 0; i < g.resources; ++i) available_resources[i] = (res_t)g.instances[i];
+        for (basic_resvec<R> &row : allocation_matrix) row.fill(0);
+    }
+
+    const char* kind() const override { return "fixed"; }
+    int num_resources() const override { return resources; }
+    int num_processes() const override { return processes; }
+    int available(int r) const override { return available_resources[r]; }
+    int allocated(int p, int r) const override { return allocation_matrix[p][r]; }
+
+    resvec available_vector() const override {
+        resvec out;
+        out.fill(0);
+        memcpy(out.v, available_resources.v, sizeof(res_t) * LANES);
+        return out;
+    }
+
+    resvec row(int p) const override {
+        resvec out;
+        out.fill(0);
+        memcpy(out.v, allocation_matrix[p].v, sizeof(res_t) * LANES);
+        return out;
+    }
+
+    int first_short(const resvec &request) const override {
+        return res_first_exceeding(request.v, available_resources.v, LANES);
+    }
+
+    void allocate(int p, const resvec &amounts) override {
+        res_subtract(available_resources.v, amounts.v, LANES);
+        res_add(allocation_matrix[p].v, amounts.v, LANES);
+    }
+
+    void release(int p, const resvec &amounts) override {
+        res_add(available_resources.v, amounts.v, LANES);
+        res_subtract(allocation_matrix[p].v, amounts.v, LANES);
+    }
+};
+
+// fallback for geometries no compile-time descriptor covers, same kernels over a runtime lane count
+class dynamic_resource_descriptor : public resource_descriptor_base {
+    int resources;
+    int processes;
+    int lanes;
+    std::vector<res_t> available_resources;
+    std::vector<res_t> allocation_matrix; // processes rows of `lanes` counts
+public:
+    explicit dynamic_resource_descriptor(const resource_geometry &g)
+        : resources(g.resources), processes(g.processes), lanes(RES_LANES(g.resources)),
+          available_resources(lanes, 0), allocation_matrix((size_t)lanes * g.processes, 0) {
+        for (int i = 0; i < g.resources; ++i) available_resources[i] = (res_t)g.instances[i];
+    }
+
+    const char* kind() const override { return "dynamic"; }
+    int num_resources() const override { return resources; }
+    int num_processes() const override { return processes; }
+    int available(int r) const override { return available_resources[r]; }
+    int allocated(int p, int r) const override { return allocation_matrix[(size_t)p * lanes + r]; }
+
+    resvec available_vector() const override {
+        resvec out;
+        out.fill(0);
+        memcpy(out.v, available_resources.data(), sizeof(res_t) * lanes);
+        return out;
+    }
+
+    resvec row(int p) const override {
+        resvec out;
+        out.fill(0);
+        memcpy(out.v, &allocation_matrix[(size_t)p * lanes], sizeof(res_t) * lanes);
+        return out;
+    }
+
+    int first_short(const resvec &request) const override {
+        return res_first_exceeding(request.v, available_resources.data(), lanes);
+    }
+
+    void allocate(int p, const resvec &amounts) override {
+        res_subtract(available_resources.data(), amounts.v, lanes);
+        res_add(&allocation_matrix[(size_t)p * lanes], amounts.v, lanes);
+    }
+
+    void release(int p, const resvec &amounts) override {
+        res_add(available_resources.data(), amounts.v, lanes);
+        res_subtract(&allocation_matrix[(size_t)p * lanes], amounts.v, lanes);
+    }
+};
+
+// pick the smallest precompiled descriptor that covers the geometry, else the dynamic one
+static inline resource_descriptor_base* make_resource_descriptor(const resource_geometry &g) {
+    if (g.resources <= 8 && g.processes <= 18) return new resource_descriptor<8, 18>(g);
+    if (g.resources <= 10 && g.processes <= 18) return new resource_descriptor<10, 18>(g);
+    if (g.resources <= 16 && g.processes <= 64) return new resource_descriptor<16, 64>(g);
+    return new dynamic_resource_descriptor(g);
+}
+
+#endif
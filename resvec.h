@@ -0,0 +1,155 @@
+#ifndef RESVEC_H
+#define RESVEC_H
+
+#include <cstdint>
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// per-resource-class counts, 16 bits wide which is plenty for instance counts
+typedef int16_t res_t;
+
+// count vectors are padded to whole 128-bit registers so every kernel is a handful of
+// SIMD ops with no tail loop; padding lanes are always zero
+#define RES_LANES(n) (((n) + 7) / 8 * 8)
+
+// kernels over `lanes` counts (a multiple of 8); with a constant lane count they
+// unroll completely, otherwise they loop over 8-lane blocks
+
+// index of the first class where a exceeds b, -1 if a fits within b everywhere
+static inline int res_first_exceeding(const res_t *a, const res_t *b, int lanes) {
+#ifdef __SSE2__
+    for (int k = 0; k < lanes; k += 8) {
+        __m128i va = _mm_loadu_si128((const __m128i*)(a + k));
+        __m128i vb = _mm_loadu_si128((const __m128i*)(b + k));
+        int mask = _mm_movemask_epi8(_mm_cmpgt_epi16(va, vb));
+        if (mask) return k + __builtin_ctz(mask) / 2;
+    }
+    return -1;
+#else
+    for (int i = 0; i < lanes; ++i) {
+        if (a[i] > b[i]) return i;
+    }
+    return -1;
+#endif
+}
+
+// a += b
+static inline void res_add(res_t *a, const res_t *b, int lanes) {
+#ifdef __SSE2__
+    for (int k = 0; k < lanes; k += 8) {
+        __m128i va = _mm_loadu_si128((const __m128i*)(a + k));
+        __m128i vb = _mm_loadu_si128((const __m128i*)(b + k));
+        _mm_storeu_si128((__m128i*)(a + k), _mm_add_epi16(va, vb));
+    }
+#else
+    for (int i = 0; i < lanes; ++i) a[i] += b[i];
+#endif
+}
+
+// a -= b
+static inline void res_subtract(res_t *a, const res_t *b, int lanes) {
+#ifdef __SSE2__
+    for (int k = 0; k < lanes; k += 8) {
+        __m128i va = _mm_loadu_si128((const __m128i*)(a + k));
+        __m128i vb = _mm_loadu_si128((const __m128i*)(b + k));
+        _mm_storeu_si128((__m128i*)(a + k), _mm_sub_epi16(va, vb));
+    }
+#else
+    for (int i = 0; i < lanes; ++i) a[i] -= b[i];
+#endif
+}
+
+// total over all classes
+static inline int res_sum(const res_t *a, int lanes) {
+#ifdef __SSE2__
+    __m128i acc = _mm_setzero_si128();
+    for (int k = 0; k < lanes; k += 8) {
+        __m128i va = _mm_loadu_si128((const __m128i*)(a + k));
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(va, _mm_set1_epi16(1)));
+    }
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(acc);
+#else
+    int total = 0;
+    for (int i = 0; i < lanes; ++i) total += a[i];
+    return total;
+#endif
+}
+
+// bit i set if class i is non-zero, at most 64 lanes
+static inline uint64_t res_nonzero_mask(const res_t *a, int lanes) {
+    uint64_t bits = 0;
+#ifdef __SSE2__
+    for (int k = 0; k < lanes; k += 8) {
+        __m128i va = _mm_loadu_si128((const __m128i*)(a + k));
+        int zero = _mm_movemask_epi8(_mm_cmpeq_epi16(va, _mm_setzero_si128()));
+        // keep one bit per 16-bit lane
+        int nonzero = ~zero & 0x5555;
+        for (int lane = 0; nonzero; ++lane, nonzero >>= 2) {
+            if (nonzero & 1) bits |= 1ULL << (k + lane);
+        }
+    }
+#else
+    for (int i = 0; i < lanes; ++i) {
+        if (a[i] != 0) bits |= 1ULL << i;
+    }
+#endif
+    return bits;
+}
+
+// fixed-size count vector for N resource classes
+template <int N>
+struct alignas(16) basic_resvec {
+    static const int LANES = RES_LANES(N);
+    res_t v[LANES];
+
+    res_t& operator[](int i) { return v[i]; }
+    const res_t& operator[](int i) const { return v[i]; }
+    void fill(int value) {
+        for (int i = 0; i < LANES; ++i) v[i] = (i < N) ? (res_t)value : 0;
+    }
+};
+
+// load counts from a plain int array of N entries
+template <int N>
+static inline basic_resvec<N> resvec_load(const int *counts) {
+    basic_resvec<N> r;
+    for (int i = 0; i < basic_resvec<N>::LANES; ++i) r.v[i] = (i < N) ? (res_t)counts[i] : 0;
+    return r;
+}
+
+template <int N>
+static inline int resvec_first_exceeding(const basic_resvec<N> &a, const basic_resvec<N> &b) {
+    return res_first_exceeding(a.v, b.v, basic_resvec<N>::LANES);
+}
+
+template <int N>
+static inline bool resvec_fits_within(const basic_resvec<N> &a, const basic_resvec<N> &b) {
+    return res_first_exceeding(a.v, b.v, basic_resvec<N>::LANES) == -1;
+}
+
+template <int N>
+static inline void resvec_add(basic_resvec<N> &a, const basic_resvec<N> &b) {
+    res_add(a.v, b.v, basic_resvec<N>::LANES);
+}
+
+template <int N>
+static inline void resvec_subtract(basic_resvec<N> &a, const basic_resvec<N> &b) {
+    res_subtract(a.v, b.v, basic_resvec<N>::LANES);
+}
+
+template <int N>
+static inline int resvec_sum(const basic_resvec<N> &a) {
+    return res_sum(a.v, basic_resvec<N>::LANES);
+}
+
+template <int N>
+static inline uint64_t resvec_nonzero_mask(const basic_resvec<N> &a) {
+    static_assert(N <= 64, "nonzero mask holds at most 64 classes");
+    return res_nonzero_mask(a.v, basic_resvec<N>::LANES);
+}
+
+#endif
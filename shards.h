@@ -0,0 +1,188 @@
+#ifndef SHARDS_H
+#define SHARDS_H
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "resources.h"
+
+// classes per shard, one SIMD block of counts so each shard's kernels are a single compare/add
+#define SHARD_CLASSES 8
+
+// one shard of the resource table: its classes' available counts and every process's allocation of them
+// the lock is a spinlock, a critical section is a handful of vector ops
+struct alignas(64) resource_shard {
+    std::atomic<bool> locked{false};
+    res_t available[SHARD_CLASSES];
+    std::vector<res_t> allocation; // one row of SHARD_CLASSES counts per process
+
+    void lock() {
+        while (locked.exchange(true, std::memory_order_acquire)) {
+            while (locked.load(std::memory_order_relaxed)) std::this_thread::yield();
+        }
+    }
+    void unlock() { locked.store(false, std::memory_order_release); }
+    res_t *row(int p) { return &allocation[(size_t)p * SHARD_CLASSES]; }
+};
+
+// resource table split into shards of SHARD_CLASSES classes for OSS's receiver threads (-X)
+//
+// every operation locks only the shards its vector touches, always in ascending order, so a
+// multi-class request is checked and granted atomically across its shards without a global lock
+// and two requests on disjoint shards never contend
+class sharded_resource_descriptor : public resource_descriptor_base {
+    int resources;
+    int processes;
+    int nshards;
+    std::unique_ptr<resource_shard[]> shards;
+
+    // bit s set if v has a non-zero count in shard s
+    unsigned shards_of(const resvec &v) const {
+        uint64_t classes = resvec_nonzero_mask(v);
+        unsigned touched = 0;
+        for (int s = 0; s < nshards; ++s) {
+            if ((classes >> (s * SHARD_CLASSES)) & 0xff) touched |= 1u << s;
+        }
+        return touched;
+    }
+
+    unsigned all_shards() const { return (1u << nshards) - 1; }
+
+    void lock(unsigned touched) const {
+        for (unsigned bits = touched; bits; bits &= bits - 1) shards[__builtin_ctz(bits)].lock();
+    }
+
+    void unlock(unsigned touched) const {
+        for (unsigned bits = touched; bits; bits &= bits - 1) shards[__builtin_ctz(bits)].unlock();
+    }
+
+    // first short class among the touched shards, shards must be locked
+    int first_short_locked(unsigned touched, const resvec &request) const {
+        for (unsigned bits = touched; bits; bits &= bits - 1) {
+            int s = __builtin_ctz(bits);
+            int r = res_first_exceeding(request.v + s * SHARD_CLASSES, shards[s].available, SHARD_CLASSES);
+            if (r != -1) return s * SHARD_CLASSES + r;
+        }
+        return -1;
+    }
+
+public:
+    explicit sharded_resource_descriptor(const resource_geometry &g)
+        : resources(g.resources), processes(g.processes), nshards(RES_LANES(g.resources) / SHARD_CLASSES),
+          shards(new resource_shard[RES_LANES(g.resources) / SHARD_CLASSES]) {
+        for (int s = 0; s < nshards; ++s) {
+            for (int i = 0; i < SHARD_CLASSES; ++i) {
+                int r = s * SHARD_CLASSES + i;
+                shards[s].available[i] = (r < g.resources) ? (res_t)g.instances[r] : 0;
+            }
+            shards[s].allocation.assign((size_t)g.processes * SHARD_CLASSES, 0);
+        }
+    }
+
+    const char* kind() const override { return "sharded"; }
+    int num_resources() const override { return resources; }
+    int num_processes() const override { return processes; }
+
+    int available(int r) const override {
+        resource_shard &s = shards[r / SHARD_CLASSES];
+        s.lock();
+        int n = s.available[r % SHARD_CLASSES];
+        s.unlock();
+        return n;
+    }
+
+    int allocated(int p, int r) const override {
+        resource_shard &s = shards[r / SHARD_CLASSES];
+        s.lock();
+        int n = s.row(p)[r % SHARD_CLASSES];
+        s.unlock();
+        return n;
+    }
+
+    resvec available_vector() const override {
+        resvec out;
+        out.fill(0);
+        lock(all_shards());
+        for (int s = 0; s < nshards; ++s) memcpy(out.v + s * SHARD_CLASSES, shards[s].available, sizeof(shards[s].available));
+        unlock(all_shards());
+        return out;
+    }
+
+    resvec row(int p) const override {
+        resvec out;
+        out.fill(0);
+        lock(all_shards());
+        for (int s = 0; s < nshards; ++s) memcpy(out.v + s * SHARD_CLASSES, shards[s].row(p), sizeof(res_t) * SHARD_CLASSES);
+        unlock(all_shards());
+        return out;
+    }
+
+    int first_short(const resvec &request) const override {
+        unsigned touched = shards_of(request);
+        lock(touched);
+        int r = first_short_locked(touched, request);
+        unlock(touched);
+        return r;
+    }
+
+    int try_allocate(int p, const resvec &request) override {
+        unsigned touched = shards_of(request);
+        lock(touched);
+        int r = first_short_locked(touched, request);
+        if (r == -1) {
+            for (unsigned bits = touched; bits; bits &= bits - 1) {
+                int s = __builtin_ctz(bits);
+                res_subtract(shards[s].available, request.v + s * SHARD_CLASSES, SHARD_CLASSES);
+                res_add(shards[s].row(p), request.v + s * SHARD_CLASSES, SHARD_CLASSES);
+            }
+        }
+        unlock(touched);
+        return r;
+    }
+
+    void allocate(int p, const resvec &amounts) override {
+        unsigned touched = shards_of(amounts);
+        lock(touched);
+        for (unsigned bits = touched; bits; bits &= bits - 1) {
+            int s = __builtin_ctz(bits);
+            res_subtract(shards[s].available, amounts.v + s * SHARD_CLASSES, SHARD_CLASSES);
+            res_add(shards[s].row(p), amounts.v + s * SHARD_CLASSES, SHARD_CLASSES);
+        }
+        unlock(touched);
+    }
+
+    void release(int p, const resvec &amounts) override {
+        unsigned touched = shards_of(amounts);
+        lock(touched);
+        for (unsigned bits = touched; bits; bits &= bits - 1) {
+            int s = __builtin_ctz(bits);
+            res_add(shards[s].available, amounts.v + s * SHARD_CLASSES, SHARD_CLASSES);
+            res_subtract(shards[s].row(p), amounts.v + s * SHARD_CLASSES, SHARD_CLASSES);
+        }
+        unlock(touched);
+    }
+
+    int try_exchange(int p, const resvec &released, const resvec &request) override {
+        unsigned given = shards_of(released), taken = shards_of(request);
+        unsigned touched = given | taken;
+        lock(touched);
+        for (unsigned bits = given; bits; bits &= bits - 1) {
+            int s = __builtin_ctz(bits);
+            res_add(shards[s].available, released.v + s * SHARD_CLASSES, SHARD_CLASSES);
+            res_subtract(shards[s].row(p), released.v + s * SHARD_CLASSES, SHARD_CLASSES);
+        }
+        int r = first_short_locked(taken, request);
+        if (r == -1) {
+            for (unsigned bits = taken; bits; bits &= bits - 1) {
+                int s = __builtin_ctz(bits);
+                res_subtract(shards[s].available, request.v + s * SHARD_CLASSES, SHARD_CLASSES);
+                res_add(shards[s].row(p), request.v + s * SHARD_CLASSES, SHARD_CLASSES);
+            }
+        }
+        unlock(touched);
+        return r;
+    }
+};
+
+#endif
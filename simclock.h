@@ -0,0 +1,32 @@
+#ifndef SIMCLOCK_H
+#define SIMCLOCK_H
+
+#include <atomic>
+#include <cstdint>
+
+#define NSEC_PER_SEC 1000000000LL
+
+// simulated system clock kept in shared memory as a single nanosecond counter
+// so readers can never see a torn seconds/nanoseconds pair
+// OSS is the only writer, workers only read
+struct sim_clock {
+    std::atomic<uint64_t> ns;
+
+    // nanoseconds since the simulation started
+    long long now() const { return (long long)ns.load(std::memory_order_acquire); }
+
+    // seconds/nanoseconds view, take one snapshot with now() when both halves are needed
+    int sec() const { return (int)(now() / NSEC_PER_SEC); }
+    int nano() const { return (int)(now() % NSEC_PER_SEC); }
+
+    void set(long long total) { ns.store((uint64_t)total, std::memory_order_release); }
+    void advance(long long inc_ns) { set(now() + inc_ns); }
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared clock must be lock free");
+
+// split a nanosecond total into the seconds/nanoseconds pair used in output
+static inline int clock_sec(long long total) { return (int)(total / NSEC_PER_SEC); }
+static inline int clock_nano(long long total) { return (int)(total % NSEC_PER_SEC); }
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef SLOTS_H
+#define SLOTS_H
+
+#include <atomic>
+#include <climits>
+#include <ctime>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "resources.h"
+
+// worker states published in the slot table
+#define SLOT_EMPTY 0    // no worker in this PCB slot
+#define SLOT_SLEEPING 1 // waiting for the clock to reach deadline
+#define SLOT_BUSY 2     // acting right now, OSS must not move the clock past it
+#define SLOT_BLOCKED 3  // request queued in OSS, waiting for an ack
+
+// one entry per PCB slot, shared between OSS and the worker occupying it
+// so OSS knows when the next worker action or termination is due
+struct worker_slot {
+    std::atomic<int> state;
+    std::atomic<long long> deadline; // simulated ns of the next action/termination
+    std::atomic<int> wake_seq;       // futex word, bumped by OSS when the clock reaches deadline
+};
+
+// one preforked worker process (-w pool), indexed by pool member rather than PCB slot
+// OSS fills in the next simulated process and bumps assign_seq, the worker sleeps on it in between
+struct pool_member {
+    std::atomic<int> assign_seq; // futex word, bumped for every assignment and at shutdown
+    int pcb_index;               // PCB slot of the assigned simulated process
+    long long time_limit_ns;     // how long that process runs
+    unsigned long long seed;     // its random seed
+    long long launch;            // and launch number
+};
+
+// the whole shared segment: worker slots plus a doorbell OSS can sleep on
+struct slot_table {
+    std::atomic<int> doorbell; // futex word, bumped by workers whenever they message OSS or reschedule
+    worker_slot slots[MAX_PROCESSES];
+    std::atomic<int> pool_shutdown; // set once OSS is done, pool members exit instead of waiting
+    pool_member pool[MAX_PROCESSES];
+};
+
+static_assert(sizeof(std::atomic<int>) == sizeof(int), "futex words must be plain ints");
+
+// sleep while *word still holds expected; timeout of nullptr waits forever
+static inline void futex_wait(std::atomic<int> *word, int expected, const struct timespec *timeout) {
+    syscall(SYS_futex, reinterpret_cast<int*>(word), FUTEX_WAIT, expected, timeout, nullptr, 0);
+}
+
+// bump the word and wake everyone sleeping on it
+static inline void futex_bump(std::atomic<int> *word) {
+    word->fetch_add(1);
+    syscall(SYS_futex, reinterpret_cast<int*>(word), FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+#endif
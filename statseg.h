@@ -0,0 +1,127 @@
+#ifndef STATSEG_H
+#define STATSEG_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <sys/ipc.h>
+#include <unistd.h>
+#include <sys/shm.h>
+#include "resources.h"
+
+// live stats segment (-M), keyed by ftok("oss.cpp", 4): OSS republishes a snapshot of its state
+// every few wall milliseconds and ossmon attaches read-only to render it
+//
+// the snapshot is guarded by a seqlock: OSS makes seq odd, writes, then makes it even again,
+// a reader copies everything out and retries if seq was odd or moved while it copied
+#define STATS_MAGIC 0x4f53534d // "OSSM"
+#define STATS_VERSION 2
+
+// counters OSS keeps, published as is
+struct stats_counters {
+    int64_t total_requests;
+    int64_t immediate_requests;
+    int64_t queued_requests;
+    int64_t mass_releases;
+    int64_t exchanges;
+    int64_t resources_requested;
+    int64_t launched;
+    int64_t running;
+    int64_t deadlock_victims;
+};
+
+struct stats_pcb {
+    int32_t occupied;
+    int32_t pid;
+    int64_t start_ns;
+};
+
+// fixed part of the segment, followed by processes stats_pcb entries and then the
+// allocation matrix as processes rows of resources counts
+struct stats_header {
+    uint32_t magic;
+    uint32_t version;
+    std::atomic<uint32_t> seq;
+    int32_t oss_pid;
+    int32_t resources;
+    int32_t processes;
+    int32_t done;            // OSS has finished, this is the final snapshot
+    int32_t pad;
+    int64_t publishes;
+    int64_t clock_ns;
+    int64_t queue_depth;
+    stats_counters counters;
+    res_t available[MAX_RESOURCES];
+};
+
+static inline size_t stats_segment_bytes(int resources, int processes) {
+    return sizeof(stats_header) + (size_t)processes * sizeof(stats_pcb) + (size_t)processes * resources * sizeof(res_t);
+}
+
+static inline stats_pcb *stats_pcbs(stats_header *h) { return (stats_pcb*) (h + 1); }
+static inline res_t *stats_allocation(stats_header *h) { return (res_t*) (stats_pcbs(h) + h->processes); }
+
+// OSS side, the only writer
+class stats_writer {
+    int shmid = -1;
+    stats_header *h = nullptr;
+public:
+    // create and attach the segment for g, false on failure
+    bool open(const resource_geometry &g) {
+        key_t key = ftok("oss.cpp", 4);
+        size_t bytes = stats_segment_bytes(g.resources, g.processes);
+        // a segment left by a killed run may be the wrong size
+        int stale = shmget(key, 0, 0666);
+        if (stale != -1) shmctl(stale, IPC_RMID, nullptr);
+        shmid = shmget(key, bytes, IPC_CREAT | 0666);
+        if (shmid == -1) return false;
+        void *p = shmat(shmid, nullptr, 0);
+        if (p == (void*) -1) return false;
+        h = (stats_header*) p;
+        memset((void*) h, 0, bytes);
+        h->magic = STATS_MAGIC;
+        h->version = STATS_VERSION;
+        h->oss_pid = getpid();
+        h->resources = g.resources;
+        h->processes = g.processes;
+        return true;
+    }
+
+    bool is_open() const { return h != nullptr; }
+
+    // open the seqlock, fill in the returned header and the tables behind it, then call end_write
+    stats_header *begin_write() {
+        h->seq.store(h->seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        return h;
+    }
+
+    void end_write() {
+        h->publishes++;
+        h->seq.store(h->seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    void remove() {
+        if (h) shmdt((void*) h);
+        if (shmid != -1) shmctl(shmid, IPC_RMID, nullptr);
+        h = nullptr;
+        shmid = -1;
+    }
+};
+
+// reader side: copy a consistent snapshot of the segment at h into out, false if OSS kept
+// writing through every attempt
+static inline bool stats_snapshot(const stats_header *h, size_t bytes, std::vector<char> &out) {
+    out.resize(bytes);
+    for (int attempt = 0; attempt < 1000; ++attempt) {
+        uint32_t before = h->seq.load(std::memory_order_acquire);
+        if (before & 1) continue;
+        memcpy(out.data(), (const void*) h, bytes);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (h->seq.load(std::memory_order_relaxed) == before) return true;
+    }
+    return false;
+}
+
+#endif
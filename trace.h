@@ -0,0 +1,133 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include "resources.h"
+
+// binary event trace (-B file): a header followed by fixed-size records in a memory-mapped
+// file, decoded offline by tracedump into the usual OSS text or CSV
+#define TRACE_MAGIC "OSSTRACE"
+#define TRACE_VERSION 1
+#define TRACE_GROW_RECORDS 65536 // the file is extended this many records at a time
+
+// event kinds, deltas holds the vector named in each comment
+#define TRACE_LAUNCH 0        // none
+#define TRACE_GRANT 1         // granted request
+#define TRACE_GRANT_QUEUED 2  // granted request that had been queued
+#define TRACE_QUEUE 3         // request queued, aux is the wait queue bucket
+#define TRACE_RELEASE 4       // released instances
+#define TRACE_MASS_RELEASE 5  // released instances
+#define TRACE_TERMINATE 6     // everything the worker still held
+#define TRACE_DEADLOCK_KILL 7 // everything the victim held
+#define TRACE_CLAIM 8         // declared maximum claim
+#define TRACE_EXCHANGE 9      // instances released by a release-and-reacquire, its request follows as a grant or queue
+#define TRACE_CLAIM_KILL 10   // everything a worker held, terminated for a request without or beyond its claim
+
+struct trace_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    int32_t resources;
+    int32_t processes;
+    int32_t instances[MAX_RESOURCES];
+    uint64_t records; // updated after every append, so a killed run still decodes
+};
+
+struct trace_record {
+    int64_t sim_ns;
+    int32_t pid;
+    int16_t pcb_index;
+    uint8_t op;
+    uint8_t pad;
+    int16_t aux;
+    int16_t reserved[3];
+    res_t deltas[MAX_RESOURCES];
+};
+
+static_assert(sizeof(trace_record) == 24 + sizeof(res_t) * MAX_RESOURCES, "trace records must stay fixed-size");
+static_assert(resvec::LANES == MAX_RESOURCES, "a resvec copies straight into a trace record");
+
+// OSS side: appends records, growing the mapping as the file fills
+class trace_writer {
+    int fd = -1;
+    char *base = nullptr;
+    size_t capacity = 0; // records the current mapping holds
+    trace_header *header() { return (trace_header*) base; }
+    trace_record *records() { return (trace_record*) (base + sizeof(trace_header)); }
+    static size_t bytes_for(size_t n) { return sizeof(trace_header) + n * sizeof(trace_record); }
+
+    bool grow() {
+        size_t next = capacity + TRACE_GROW_RECORDS;
+        if (ftruncate(fd, bytes_for(next)) == -1) return false;
+        void *p = (base == nullptr) ? mmap(nullptr, bytes_for(next), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                                    : mremap(base, bytes_for(capacity), bytes_for(next), MREMAP_MAYMOVE);
+        if (p == MAP_FAILED) return false;
+        base = (char*) p;
+        capacity = next;
+        return true;
+    }
+
+public:
+    ~trace_writer() { close(); }
+
+    // create path and write the header, false on failure
+    bool open(const std::string &path, const resource_geometry &g) {
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd == -1 || !grow()) return false;
+        trace_header *h = header();
+        memcpy(h->magic, TRACE_MAGIC, sizeof(h->magic));
+        h->version = TRACE_VERSION;
+        h->record_size = sizeof(trace_record);
+        h->resources = g.resources;
+        h->processes = g.processes;
+        for (int i = 0; i < MAX_RESOURCES; ++i) h->instances[i] = g.instances[i];
+        h->records = 0;
+        return true;
+    }
+
+    bool ok() const { return base != nullptr; }
+    uint64_t count() const { return base ? ((const trace_header*) base)->records : 0; }
+
+    // append one event, false (and tracing stops) if the file could not be grown
+    bool append(uint8_t op, long long sim_ns, pid_t pid, int pcb_index, const resvec *deltas, int aux = 0) {
+        if (base == nullptr) return false;
+        uint64_t n = header()->records;
+        if (n == capacity && !grow()) {
+            close();
+            return false;
+        }
+        trace_record &r = records()[n];
+        r.sim_ns = sim_ns;
+        r.pid = pid;
+        r.pcb_index = (int16_t) pcb_index;
+        r.op = op;
+        r.pad = 0;
+        r.aux = (int16_t) aux;
+        memset(r.reserved, 0, sizeof(r.reserved));
+        if (deltas) memcpy(r.deltas, deltas->v, sizeof(r.deltas));
+        else memset(r.deltas, 0, sizeof(r.deltas));
+        header()->records = n + 1;
+        return true;
+    }
+
+    // trim the file to the records written and unmap it, safe to call more than once
+    void close() {
+        if (base != nullptr) {
+            size_t used = bytes_for(header()->records);
+            munmap(base, bytes_for(capacity));
+            base = nullptr;
+            if (ftruncate(fd, used) == -1) {} // a longer file still decodes, the header has the count
+        }
+        if (fd != -1) ::close(fd);
+        fd = -1;
+        capacity = 0;
+    }
+};
+
+#endif
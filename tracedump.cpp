@@ -0,0 +1,244 @@
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <unordered_map>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "resources.h"
+#include "simclock.h"
+#include "waitqueue.h"
+#include "trace.h"
+
+using namespace std;
+
+// decode a binary trace written by oss -B into the OSS text log (default) or CSV (-c),
+// or check it (-k) for what OSS must never do
+
+static const char* op_name(int op) {
+    switch (op) {
+        case TRACE_LAUNCH: return "launch";
+        case TRACE_GRANT: return "grant";
+        case TRACE_GRANT_QUEUED: return "grant_queued";
+        case TRACE_QUEUE: return "queue";
+        case TRACE_RELEASE: return "release";
+        case TRACE_MASS_RELEASE: return "mass_release";
+        case TRACE_TERMINATE: return "terminate";
+        case TRACE_DEADLOCK_KILL: return "deadlock_kill";
+        case TRACE_CLAIM: return "claim";
+        case TRACE_EXCHANGE: return "exchange";
+        case TRACE_CLAIM_KILL: return "claim_kill";
+        default: return "unknown";
+    }
+}
+
+// "R0:2 R3:1 " for every non-zero delta, as OSS prints it
+static void print_deltas(const trace_record &r, int resources) {
+    for (int i = 0; i < resources; i++) {
+        if (r.deltas[i] > 0) cout << "R" << i << ":" << r.deltas[i] << " ";
+    }
+}
+
+static void print_available(const int *available, int resources) {
+    cout << "OSS: available resources: ";
+    for (int i = 0; i < resources; i++) cout << "R" << i << ":" << available[i] << " ";
+    cout << endl;
+}
+
+// apply r to the replayed available vector as OSS applied it to the table
+static void replay(int *available, const trace_record &r, int resources) {
+    bool known = r.pcb_index >= 0;
+    switch (r.op) {
+        case TRACE_GRANT:
+            if (known) for (int i = 0; i < resources; i++) available[i] -= r.deltas[i];
+            break;
+        case TRACE_GRANT_QUEUED:
+            for (int i = 0; i < resources; i++) available[i] -= r.deltas[i];
+            break;
+        case TRACE_RELEASE:
+        case TRACE_MASS_RELEASE:
+        case TRACE_EXCHANGE:
+            if (known) for (int i = 0; i < resources; i++) available[i] += r.deltas[i];
+            break;
+        case TRACE_TERMINATE:
+        case TRACE_DEADLOCK_KILL:
+        case TRACE_CLAIM_KILL:
+            for (int i = 0; i < resources; i++) available[i] += r.deltas[i];
+            break;
+    }
+}
+
+// -k: the replayed available counts stay within 0..instances, and a release-and-reacquire is never
+// queued behind other requests right after its own release; returns the number of violations
+static long long check_trace(const trace_header *h, const trace_record *rec, uint64_t records) {
+    int resources = h->resources;
+    int available[MAX_RESOURCES];
+    for (int i = 0; i < MAX_RESOURCES; i++) available[i] = h->instances[i];
+    unordered_map<int32_t, uint64_t> exchanged; // pid -> its exchange record, until its next record
+    long long violations = 0, exchanges = 0;
+    auto report = [&](uint64_t n, const trace_record &r, const string &what) {
+        if (violations++ < 10) cerr << "tracedump: record " << n << " (" << op_name(r.op) << ", pid " << r.pid << "): " << what << endl;
+    };
+    for (uint64_t n = 0; n < records; ++n) {
+        const trace_record &r = rec[n];
+        auto it = exchanged.find(r.pid);
+        if (it != exchanged.end()) {
+            if (r.op == TRACE_QUEUE && r.aux == WAIT_BEHIND) {
+                report(n, r, "release-and-reacquire of record " + to_string(it->second) + " queued behind other requests");
+            }
+            exchanged.erase(it);
+        }
+        if (r.op == TRACE_EXCHANGE) {
+            exchanged[r.pid] = n;
+            exchanges++;
+        }
+        replay(available, r, resources);
+        for (int i = 0; i < resources; i++) {
+            if (available[i] < 0 || available[i] > h->instances[i]) {
+                report(n, r, "R" + to_string(i) + " available " + to_string(available[i]) + " of " + to_string(h->instances[i]));
+                break;
+            }
+        }
+    }
+    cerr << "tracedump: " << records << " records, " << exchanges << " release-and-reacquires checked, "
+         << violations << " violations" << endl;
+    return violations;
+}
+
+static void print_time(long long sim_ns) {
+    cout << "at time " << clock_sec(sim_ns) << "s " << clock_nano(sim_ns) << "ns" << endl;
+}
+
+int main(int argc, char* argv[]) {
+    bool csv = false;
+    bool check = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "hck")) != -1) {
+        switch (opt) {
+            case 'c':
+                csv = true;
+                break;
+            case 'k':
+                check = true;
+                break;
+            default:
+                cerr << "Usage: tracedump [-c | -k] tracefile\n"
+                     << "  -c    Write CSV (one row per event) instead of the OSS text log\n"
+                     << "  -k    Check the trace instead: available counts stay within 0..instances and no\n"
+                     << "        release-and-reacquire is queued behind other requests; exits 1 on a violation" << endl;
+                exit(opt == 'h' ? 0 : 1);
+        }
+    }
+    if (optind >= argc) {
+        cerr << "Usage: tracedump [-c | -k] tracefile" << endl;
+        exit(1);
+    }
+
+    int fd = open(argv[optind], O_RDONLY);
+    struct stat st;
+    if (fd == -1 || fstat(fd, &st) == -1) {
+        perror("open trace");
+        exit(1);
+    }
+    if ((size_t)st.st_size < sizeof(trace_header)) {
+        cerr << "tracedump: " << argv[optind] << " is too short to be a trace" << endl;
+        exit(1);
+    }
+    void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) {
+        perror("mmap trace");
+        exit(1);
+    }
+    const trace_header *h = (const trace_header*) p;
+    if (memcmp(h->magic, TRACE_MAGIC, sizeof(h->magic)) != 0 || h->version != TRACE_VERSION || h->record_size != sizeof(trace_record)) {
+        cerr << "tracedump: " << argv[optind] << " is not a version " << TRACE_VERSION << " OSS trace" << endl;
+        exit(1);
+    }
+    // a trace cut short mid-write decodes up to its last whole record
+    uint64_t records = min<uint64_t>(h->records, (st.st_size - sizeof(trace_header)) / sizeof(trace_record));
+    const trace_record *rec = (const trace_record*) ((const char*) p + sizeof(trace_header));
+    int resources = h->resources;
+
+    if (check) {
+        long long violations = check_trace(h, rec, records);
+        munmap(p, st.st_size);
+        close(fd);
+        return violations == 0 ? 0 : 1;
+    }
+
+    if (csv) {
+        cout << "sim_ns,op,pid,pcb_index,aux";
+        for (int i = 0; i < resources; i++) cout << ",R" << i;
+        cout << "\n";
+        for (uint64_t n = 0; n < records; ++n) {
+            const trace_record &r = rec[n];
+            cout << r.sim_ns << "," << op_name(r.op) << "," << r.pid << "," << r.pcb_index << "," << r.aux;
+            for (int i = 0; i < resources; i++) cout << "," << r.deltas[i];
+            cout << "\n";
+        }
+        munmap(p, st.st_size);
+        close(fd);
+        return 0;
+    }
+
+    // replay the available vector so allocation and release lines show it as OSS would have
+    int available[MAX_RESOURCES];
+    for (int i = 0; i < MAX_RESOURCES; i++) available[i] = h->instances[i];
+    for (uint64_t n = 0; n < records; ++n) {
+        const trace_record &r = rec[n];
+        replay(available, r, resources);
+        switch (r.op) {
+            case TRACE_LAUNCH:
+                cout << "OSS: Launched worker " << r.pid << " in PCB slot " << r.pcb_index << " ";
+                print_time(r.sim_ns);
+                break;
+            case TRACE_CLAIM:
+                cout << "OSS: Worker " << r.pid << " declares maximum claim ";
+                print_deltas(r, resources);
+                print_time(r.sim_ns);
+                break;
+            case TRACE_GRANT:
+                cout << "OSS: Resources allocated to worker " << r.pid << " ";
+                print_deltas(r, resources);
+                print_time(r.sim_ns);
+                print_available(available, resources);
+                break;
+            case TRACE_GRANT_QUEUED:
+                cout << "OSS: Allocated queued resources to worker " << r.pid << " ";
+                print_deltas(r, resources);
+                print_time(r.sim_ns);
+                break;
+            case TRACE_QUEUE:
+                cout << "OSS: " << (r.aux == WAIT_UNSAFE ? "Granting would be unsafe" : r.aux == WAIT_BEHIND ? "Requests ahead of it are waiting" : "Resources not available") << " for worker " << r.pid
+                     << ", request queued. At time " << clock_sec(r.sim_ns) << "s " << clock_nano(r.sim_ns) << "ns" << endl;
+                break;
+            case TRACE_RELEASE:
+            case TRACE_MASS_RELEASE:
+            case TRACE_EXCHANGE:
+                cout << "OSS: Resources released by worker " << r.pid << " ";
+                print_deltas(r, resources);
+                print_time(r.sim_ns);
+                print_available(available, resources);
+                break;
+            case TRACE_TERMINATE:
+                cout << "OSS: Worker " << r.pid << " indicates it is terminating. " << endl;
+                break;
+            case TRACE_DEADLOCK_KILL:
+                cout << "OSS: Terminating worker " << r.pid << " to resolve deadlock, releasing ";
+                print_deltas(r, resources);
+                cout << endl;
+                break;
+            case TRACE_CLAIM_KILL:
+                cout << "OSS: Terminating worker " << r.pid << " for requesting beyond its maximum claim, releasing ";
+                print_deltas(r, resources);
+                cout << endl;
+                break;
+            default:
+                cout << "OSS: unknown trace record op " << (int)r.op << endl;
+        }
+    }
+    munmap(p, st.st_size);
+    close(fd);
+    return 0;
+}
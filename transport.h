@@ -0,0 +1,370 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <sched.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <sys/msg.h>
+#include <unistd.h>
+#include "resources.h"
+#include "slots.h"
+
+// decoded form of every message, also the legacy wire format (-W legacy)
+struct MessageBuffer {
+    long mtype;
+    pid_t pid;
+    int request_or_release; // 1 for request, 0 for release
+    int resource_request[MAX_RESOURCES]; // array of resource requests
+    int resource_release[MAX_RESOURCES]; // array of resource releases
+    int mass_release; // 1 if mass release 0 if not
+    int process_running; // 1 if running, 0 if not
+    int declare_claim; // 1 if resource_request is the worker's maximum claim, sent once at startup
+    int exchange; // 1 if resource_release goes back before resource_request is requested, as one operation
+};
+
+// compact wire format: a fixed header plus only the (resource, count) pairs a message touches
+#define OP_TERMINATE 0
+#define OP_REQUEST 1
+#define OP_RELEASE 2
+#define OP_MASS_RELEASE 3
+#define OP_ACK 4
+#define OP_CLAIM 5
+#define OP_EXCHANGE 6
+
+// in an exchange the released pairs come first, marked with this bit in their count
+#define WIRE_RELEASED 0x8000
+
+static_assert(2 * MAX_RESOURCES <= 255, "compact wire format stores the pair count in a byte");
+
+struct wire_pair {
+    uint16_t resource;
+    uint16_t count;
+};
+
+struct WireMessage {
+    long mtype;
+    pid_t pid;
+    int16_t pcb_index;
+    uint8_t op;
+    uint8_t npairs;
+    wire_pair pairs[2 * MAX_RESOURCES]; // an exchange carries a release and a request
+};
+
+// bytes after mtype that actually need to be sent, an ack is header only
+static inline size_t wire_size(const WireMessage &w) {
+    return offsetof(WireMessage, pairs) - sizeof(long) + w.npairs * sizeof(wire_pair);
+}
+
+static inline void wire_encode(const MessageBuffer &msg, int slot, WireMessage &w) {
+    w.mtype = msg.mtype;
+    w.pid = msg.pid;
+    w.pcb_index = (int16_t)slot;
+    w.npairs = 0;
+    const int *amounts = msg.resource_request;
+    if (msg.process_running == 0) {
+        w.op = OP_TERMINATE;
+        return;
+    } else if (msg.declare_claim) {
+        w.op = OP_CLAIM;
+    } else if (msg.exchange) {
+        w.op = OP_EXCHANGE;
+        for (int i = 0; i < MAX_RESOURCES; ++i) {
+            if (msg.resource_release[i] > 0) w.pairs[w.npairs++] = {(uint16_t)i, (uint16_t)(msg.resource_release[i] | WIRE_RELEASED)};
+        }
+    } else if (msg.request_or_release == 1) {
+        w.op = OP_REQUEST;
+    } else {
+        w.op = msg.mass_release ? OP_MASS_RELEASE : OP_RELEASE;
+        amounts = msg.resource_release;
+    }
+    for (int i = 0; i < MAX_RESOURCES; ++i) {
+        if (amounts[i] > 0) w.pairs[w.npairs++] = {(uint16_t)i, (uint16_t)amounts[i]};
+    }
+}
+
+static inline void wire_decode(const WireMessage &w, MessageBuffer &msg) {
+    memset(&msg, 0, sizeof(msg));
+    msg.mtype = w.mtype;
+    msg.pid = w.pid;
+    msg.process_running = (w.op != OP_TERMINATE);
+    msg.request_or_release = (w.op == OP_REQUEST || w.op == OP_ACK || w.op == OP_EXCHANGE);
+    msg.mass_release = (w.op == OP_MASS_RELEASE);
+    msg.declare_claim = (w.op == OP_CLAIM);
+    msg.exchange = (w.op == OP_EXCHANGE);
+    if (msg.exchange) {
+        for (int i = 0; i < w.npairs; ++i) {
+            const wire_pair &p = w.pairs[i];
+            if (p.count & WIRE_RELEASED) msg.resource_release[p.resource] = p.count & ~WIRE_RELEASED;
+            else msg.resource_request[p.resource] = p.count;
+        }
+        return;
+    }
+    int *amounts = (w.op == OP_REQUEST || w.op == OP_CLAIM) ? msg.resource_request : msg.resource_release;
+    for (int i = 0; i < w.npairs; ++i) amounts[w.pairs[i].resource] = w.pairs[i].count;
+}
+
+// how workers and OSS exchange messages, picked by OSS at startup and passed to workers
+// the worker side calls send/wait_ack with its PCB slot, the OSS side calls poll/ack
+class transport {
+public:
+    virtual ~transport() {}
+    virtual const char* name() const = 0;
+
+    // worker side: send msg to OSS, false on failure
+    virtual bool send(int slot, MessageBuffer &msg) = 0;
+    // worker side: block until OSS acknowledges the last message sent, false on failure
+    virtual bool wait_ack(int slot, MessageBuffer &msg) = 0;
+
+    // OSS side: non-blocking receive, 1 if msg was filled, 0 if nothing is pending, -1 on error
+    virtual int poll(MessageBuffer &msg) = 0;
+    // OSS side: take up to max pending messages into out (cleared first), how many were taken or -1 on error
+    virtual int poll_batch(std::vector<MessageBuffer> &out, size_t max) {
+        out.clear();
+        MessageBuffer msg;
+        while (out.size() < max) {
+            int ret = poll(msg);
+            if (ret == -1) return -1;
+            if (ret == 0) break;
+            out.push_back(msg);
+        }
+        return (int)out.size();
+    }
+    // OSS side: acknowledge the worker in PCB slot `slot`, false on failure
+    virtual bool ack(int slot, pid_t pid) = 0;
+    // OSS side: clear any per-slot state before a new worker takes the slot
+    virtual void reset_slot(int slot) {}
+    // OSS side: remove the underlying IPC object
+    virtual void remove() = 0;
+};
+
+// SysV message queue keyed by ftok("oss.cpp", 1), requests go to OSS's pid and acks to the worker's pid
+// with compact set, messages travel as WireMessage and only the used bytes are copied
+//
+// the queue is bounded (msgmnb, 16KB by default, about 30 legacy messages), so OSS never blocks sending
+// an ack: if the queue is full it takes pending requests off it into a backlog that poll serves first,
+// which frees room, and tries again; workers blocked sending into a full queue cannot hold OSS up
+class msg_transport : public transport {
+    int msgid;
+    bool compact;
+    std::mutex backlog_lock;             // receiver threads poll and ack concurrently
+    std::deque<MessageBuffer> backlog;   // OSS side: requests taken off a full queue by ack
+
+    // OSS side: non-blocking receive straight from the queue
+    int receive(MessageBuffer &msg) {
+        if (compact) {
+            WireMessage w;
+            if (msgrcv(msgid, &w, sizeof(WireMessage) - sizeof(long), getpid(), IPC_NOWAIT) != -1) {
+                wire_decode(w, msg);
+                return 1;
+            }
+            return (errno == ENOMSG) ? 0 : -1;
+        }
+        size_t msg_size = sizeof(MessageBuffer) - sizeof(long);
+        if (msgrcv(msgid, &msg, msg_size, getpid(), IPC_NOWAIT) != -1) return 1;
+        return (errno == ENOMSG) ? 0 : -1;
+    }
+
+    // OSS side: send without blocking, making room from the queue while it is full
+    bool send_ack(const void *m, size_t size) {
+        while (msgsnd(msgid, m, size, IPC_NOWAIT) == -1) {
+            if (errno != EAGAIN) return false;
+            MessageBuffer pending;
+            int ret = receive(pending);
+            if (ret == -1) return false;
+            if (ret == 1) {
+                std::lock_guard<std::mutex> hold(backlog_lock);
+                backlog.push_back(pending);
+            } else {
+                sched_yield(); // full of acks only, workers are taking them
+            }
+        }
+        return true;
+    }
+public:
+    msg_transport(bool create, bool compact) : compact(compact) {
+        key_t msg_key = ftok("oss.cpp", 1);
+        msgid = msgget(msg_key, create ? (IPC_CREAT | 0666) : 0666);
+    }
+    bool ok() const { return msgid != -1; }
+    const char* name() const override { return "msg"; }
+
+    bool send(int slot, MessageBuffer &msg) override {
+        if (compact) {
+            WireMessage w;
+            wire_encode(msg, slot, w);
+            return msgsnd(msgid, &w, wire_size(w), 0) != -1;
+        }
+        size_t msg_size = sizeof(MessageBuffer) - sizeof(long);
+        return msgsnd(msgid, &msg, msg_size, 0) != -1;
+    }
+
+    bool wait_ack(int slot, MessageBuffer &msg) override {
+        if (compact) {
+            WireMessage w;
+            if (msgrcv(msgid, &w, sizeof(WireMessage) - sizeof(long), getpid(), 0) == -1) return false;
+            wire_decode(w, msg);
+            return true;
+        }
+        size_t rcv_size = sizeof(MessageBuffer) - sizeof(long);
+        return msgrcv(msgid, &msg, rcv_size, getpid(), 0) != -1;
+    }
+
+    int poll(MessageBuffer &msg) override {
+        {
+            std::lock_guard<std::mutex> hold(backlog_lock);
+            if (!backlog.empty()) {
+                msg = backlog.front();
+                backlog.pop_front();
+                return 1;
+            }
+        }
+        return receive(msg);
+    }
+
+    bool ack(int slot, pid_t pid) override {
+        if (compact) {
+            WireMessage w;
+            w.mtype = pid;
+            w.pid = getpid();
+            w.pcb_index = (int16_t)slot;
+            w.op = OP_ACK;
+            w.npairs = 0;
+            return send_ack(&w, wire_size(w));
+        }
+        MessageBuffer ackMessage;
+        memset(&ackMessage, 0, sizeof(ackMessage));
+        ackMessage.mtype = pid;
+        ackMessage.process_running = 1;
+        size_t ack_size = sizeof(MessageBuffer) - sizeof(long);
+        return send_ack(&ackMessage, ack_size);
+    }
+
+    void remove() override { msgctl(msgid, IPC_RMID, nullptr); }
+};
+
+#define RING_SIZE 4 // a worker has its startup claim, at most one message in flight and its termination notice
+
+// one worker's channel: a single-producer/single-consumer ring of compact messages written by the worker
+// and drained by OSS, plus an ack slot whose sequence number doubles as a futex word
+struct ring_channel {
+    alignas(64) std::atomic<unsigned> head; // next ring index the worker writes
+    alignas(64) std::atomic<unsigned> tail; // next ring index OSS reads
+    WireMessage ring[RING_SIZE];
+    alignas(64) std::atomic<int> ack_seq;   // bumped by OSS for every ack
+};
+
+struct ring_segment {
+    ring_channel channels[MAX_PROCESSES];
+};
+
+// lock-free shared memory transport keyed by ftok("oss.cpp", 3), no syscalls on the request path
+class ring_transport : public transport {
+    int ring_shmid;
+    ring_segment *seg;
+    int channels;                // PCB slots in use, only these rings are drained
+    int expected_seq = 0;        // worker side: ack_seq value before our last send
+    int next_ring = 0;           // OSS side: where the next drain pass starts
+    std::deque<MessageBuffer> drained; // OSS side: messages taken in the last drain pass
+public:
+    ring_transport(bool create, int channels) : seg(nullptr), channels(channels) {
+        key_t ring_key = ftok("oss.cpp", 3);
+        ring_shmid = shmget(ring_key, sizeof(ring_segment), create ? (IPC_CREAT | 0666) : 0666);
+        if (ring_shmid == -1) return;
+        void *p = shmat(ring_shmid, nullptr, 0);
+        if (p == (void*) -1) return;
+        seg = (ring_segment*) p;
+        if (create) {
+            for (int i = 0; i < MAX_PROCESSES; ++i) reset_slot(i);
+        }
+    }
+    ~ring_transport() override { if (seg) shmdt(seg); }
+    bool ok() const { return seg != nullptr; }
+    const char* name() const override { return "ring"; }
+
+    bool send(int slot, MessageBuffer &msg) override {
+        if (slot < 0 || slot >= MAX_PROCESSES) return false;
+        ring_channel &ch = seg->channels[slot];
+        expected_seq = ch.ack_seq.load(std::memory_order_acquire);
+        unsigned head = ch.head.load(std::memory_order_relaxed);
+        while (head - ch.tail.load(std::memory_order_acquire) >= RING_SIZE) sched_yield(); // ring full
+        wire_encode(msg, slot, ch.ring[head % RING_SIZE]);
+        ch.head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool wait_ack(int slot, MessageBuffer &msg) override {
+        if (slot < 0 || slot >= MAX_PROCESSES) return false;
+        ring_channel &ch = seg->channels[slot];
+        while (ch.ack_seq.load(std::memory_order_acquire) == expected_seq) {
+            futex_wait(&ch.ack_seq, expected_seq, nullptr);
+        }
+        memset(&msg, 0, sizeof(msg));
+        msg.mtype = getpid();
+        msg.process_running = 1;
+        return true;
+    }
+
+    int poll(MessageBuffer &msg) override {
+        if (drained.empty()) {
+            // drain every ring in one pass, starting where the last pass left off for fairness
+            for (int n = 0; n < channels; ++n) {
+                ring_channel &ch = seg->channels[(next_ring + n) % channels];
+                unsigned tail = ch.tail.load(std::memory_order_relaxed);
+                unsigned head = ch.head.load(std::memory_order_acquire);
+                for (; tail != head; ++tail) {
+                    MessageBuffer msg;
+                    wire_decode(ch.ring[tail % RING_SIZE], msg);
+                    drained.push_back(msg);
+                }
+                ch.tail.store(tail, std::memory_order_release);
+            }
+            next_ring = (next_ring + 1) % channels;
+            if (drained.empty()) return 0;
+        }
+        msg = drained.front();
+        drained.pop_front();
+        return 1;
+    }
+
+    bool ack(int slot, pid_t pid) override {
+        if (slot < 0 || slot >= MAX_PROCESSES) return false;
+        futex_bump(&seg->channels[slot].ack_seq);
+        return true;
+    }
+
+    void reset_slot(int slot) override {
+        ring_channel &ch = seg->channels[slot];
+        ch.head = 0;
+        ch.tail = 0;
+        ch.ack_seq = 0;
+    }
+
+    void remove() override { shmctl(ring_shmid, IPC_RMID, nullptr); }
+};
+
+// build the transport named on the command line, nullptr if the name is unknown or setup failed
+// the ring always carries compact messages, wire only picks the message queue format
+// channels is how many PCB slots OSS uses
+static inline transport* make_transport(const std::string &kind, const std::string &wire, bool create, int channels = MAX_PROCESSES) {
+    if (kind == "msg") {
+        msg_transport *t = new msg_transport(create, wire != "legacy");
+        if (t->ok()) return t;
+        delete t;
+    } else if (kind == "ring") {
+        ring_transport *t = new ring_transport(create, channels);
+        if (t->ok()) return t;
+        delete t;
+    }
+    return nullptr;
+}
+
+#endif
@@ -0,0 +1,118 @@
+#ifndef WAITQUEUE_H
+#define WAITQUEUE_H
+
+#include <vector>
+#include <algorithm>
+#include "resources.h"
+#include "transport.h"
+
+// bucket for requests that fit but were held back by avoidance as unsafe
+#define WAIT_UNSAFE MAX_RESOURCES
+// bucket for requests a strict grant order keeps behind an older one
+#define WAIT_BEHIND (MAX_RESOURCES + 1)
+
+// a request OSS could not grant yet, seq keeps arrival order across requeues
+struct waiter {
+    long long seq;
+    MessageBuffer msg;
+    resvec need; // msg.resource_request as a resource vector
+    long long arrived_sim;  // simulated clock when OSS received the request
+    long long arrived_wall; // CLOCK_MONOTONIC when OSS received the request
+};
+
+// queued requests bucketed by the first resource each one is short of
+// only buckets whose resource was released since the last pass are rechecked,
+// so nothing is scanned while availability has not changed
+class wait_queue {
+    std::vector<std::vector<waiter>> buckets;
+    std::vector<char> dirty;
+    bool any_dirty = false;
+    size_t count = 0;
+    long long next_seq = 0;
+public:
+    wait_queue() : buckets(MAX_RESOURCES + 2), dirty(MAX_RESOURCES + 2, 0) {}
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    // queue a new request that is short of short_resource (or WAIT_UNSAFE/WAIT_BEHIND)
+    void push(const MessageBuffer &msg, const resvec &need, int short_resource, long long arrived_sim, long long arrived_wall) {
+        requeue({next_seq++, msg, need, arrived_sim, arrived_wall}, short_resource);
+    }
+
+    // put a rechecked waiter back under the resource it is now short of, keeping its place in line
+    void requeue(const waiter &w, int short_resource) {
+        buckets[short_resource].push_back(w);
+        count++;
+    }
+
+    // instances of resource r were returned to the pool
+    // any release can make a held back request safe or let the request in front of it go,
+    // so the held back buckets are rechecked too
+    void released(int r) {
+        mark(r);
+        mark(WAIT_UNSAFE);
+        mark(WAIT_BEHIND);
+    }
+
+    // a process left or changed its claim, unsafe requests may be safe now
+    void safety_changed() { mark(WAIT_UNSAFE); }
+
+    // a request was held back for the next pass, recheck the held back bucket then
+    void held_back() { mark(WAIT_BEHIND); }
+
+    // call f on every waiter, in no particular order
+    template <class F>
+    void for_each(F f) const {
+        for (const std::vector<waiter> &bucket : buckets) {
+            for (const waiter &w : bucket) f(w);
+        }
+    }
+
+    // drop whatever pid has queued, used when OSS terminates it
+    void remove_pid(pid_t pid) {
+        for (std::vector<waiter> &bucket : buckets) {
+            size_t before = bucket.size();
+            bucket.erase(std::remove_if(bucket.begin(), bucket.end(), [&](const waiter &w) { return w.msg.pid == pid; }), bucket.end());
+            count -= before - bucket.size();
+        }
+        mark(WAIT_BEHIND); // what was behind pid's request may be at the front now
+    }
+
+    // arrival sequence of the oldest queued request, -1 if the queue is empty
+    long long oldest_seq() const {
+        long long oldest = -1;
+        for_each([&](const waiter &w) {
+            if (oldest == -1 || w.seq < oldest) oldest = w.seq;
+        });
+        return oldest;
+    }
+
+    // true if some waiter may have become satisfiable since the last pass
+    bool has_candidates() const { return any_dirty; }
+
+    // remove and return, in arrival order, every waiter blocked on a released resource
+    // the caller grants each one or requeues it
+    std::vector<waiter> take_candidates() {
+        std::vector<waiter> out;
+        for (size_t r = 0; r < buckets.size(); ++r) {
+            if (!dirty[r]) continue;
+            dirty[r] = 0;
+            out.insert(out.end(), buckets[r].begin(), buckets[r].end());
+            buckets[r].clear();
+        }
+        any_dirty = false;
+        count -= out.size();
+        sort(out.begin(), out.end(), [](const waiter &a, const waiter &b) { return a.seq < b.seq; });
+        return out;
+    }
+
+private:
+    void mark(int r) {
+        if (buckets[r].empty()) return;
+        dirty[r] = 1;
+        any_dirty = true;
+    }
+};
+
+#endif
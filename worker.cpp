@@ -7,29 +7,27 @@
 #include <cstdlib>
 #include <errno.h>
 #include "resources.h"
+#include "slots.h"
+#include "simclock.h"
+#include "transport.h"
+#include "workload.h"
 #include <random>
 #include <algorithm>
 #include <cstring> 
 
 using namespace std;
 
-struct MessageBuffer {
-    long mtype;
-    pid_t pid;
-    int request_or_release; // 1 for request, 0 for release
-    int resource_request[MAX_RESOURCES]; // array of resource requests
-    int resource_release[MAX_RESOURCES]; // array of resource releases
-    int mass_release; // 1 if mass release 0 if not
-    int process_running; // 1 if running, 0 if not
-};
+mt19937 gen; // reseeded for every simulated process from the seed OSS hands it
 
-random_device rd;
-mt19937 gen(rd());
+// resource mix OSS runs with, passed on the command line
+resource_geometry geometry;
+// most of each resource this worker will ever hold: every instance, or its declared claim under avoidance
+int max_claim[MAX_RESOURCES];
 
 int get_resource_request(int* held_resources) {
-    uniform_int_distribution<> dis(0, MAX_RESOURCES - 1);
+    uniform_int_distribution<> dis(0, geometry.resources - 1);
     int resource_index = dis(gen);
-    if (held_resources[resource_index] >= MAX_INSTANCES) {
+    if (held_resources[resource_index] >= max_claim[resource_index]) {
         // already holding max instances of this resource, try again
         return get_resource_request(held_resources);
     }
@@ -37,7 +35,7 @@ int get_resource_request(int* held_resources) {
 }
 
 int get_resource_release(int* held_resources) {
-    uniform_int_distribution<> dis(0, MAX_RESOURCES - 1);
+    uniform_int_distribution<> dis(0, geometry.resources - 1);
     int resource_index = dis(gen);
     if (held_resources[resource_index] == 0) {
         // not holding any instances of this resource, try again
@@ -51,252 +49,456 @@ int main(int argc, char* argv[]) {
     key_t sh_key = ftok("oss.cpp", 0);
 
     // create/get shared memory
-    int shmid = shmget(sh_key, sizeof(int)*2, 0666);
+    int shmid = shmget(sh_key, sizeof(sim_clock), 0666);
     if (shmid == -1) {
         cerr << "shmget";
         exit(1);
     }
 
     // attach shared memory to shm_ptr
-    int* clock = (int*) shmat(shmid, nullptr, 0);
-    if (clock == (int*) -1) {
+    sim_clock* clock = (sim_clock*) shmat(shmid, nullptr, 0);
+    if (clock == (sim_clock*) -1) {
         cerr << "shmat";
         exit(1);
     }
 
-    int *sec = &(clock[0]);
-    int *nano = &(clock[1]);
-    
     // get target time from command line args
     int target_seconds = stoi(argv[1]);
     int target_nano = stoi(argv[2]);
 
-    // setup message queue
-    key_t msg_key = ftok("oss.cpp", 1);
-    int msgid = msgget(msg_key, 0666);
-    if (msgid == -1) {
-        cerr << "msgget";
+    // attach worker slot table, the PCB slot index is passed by OSS
+    int pcb_index = (argc > 3) ? stoi(argv[3]) : -1;
+    key_t slot_key = ftok("oss.cpp", 2);
+    int slot_shmid = shmget(slot_key, sizeof(slot_table), 0666);
+    if (slot_shmid == -1) {
+        cerr << "shmget";
+        exit(1);
+    }
+    slot_table* slot_tab = (slot_table*) shmat(slot_shmid, nullptr, 0);
+    if (slot_tab == (slot_table*) -1) {
+        cerr << "shmat";
         exit(1);
     }
 
-    // how many of each resource this process has
-    int held_resources[MAX_RESOURCES] = {0};
-    int latest_requested_resource_index = -1;
+    // setup message transport chosen by OSS
+    string transport_kind = (argc > 4) ? argv[4] : "msg";
+    string wire_format = (argc > 5) ? argv[5] : "legacy";
+    transport* channel = make_transport(transport_kind, wire_format, false);
+    if (channel == nullptr) {
+        cerr << "transport setup";
+        exit(1);
+    }
 
-    // calculate termination time
-    int end_seconds = *sec + target_seconds;
-    int end_nano = *nano + target_nano;
-    if (end_nano >= 1000000000) {
-        end_seconds += end_nano / 1000000000;
-        end_nano = end_nano % 1000000000;
+    // resource geometry chosen by OSS
+    if (argc > 7) {
+        geometry.resources = stoi(argv[6]);
+        if (geometry.resources < 1 || geometry.resources > MAX_RESOURCES || !geometry.parse_instances(argv[7])) {
+            cerr << "bad resource geometry";
+            exit(1);
+        }
     }
-    
-    // get random time interval for when to request/release resources
-    uniform_int_distribution<> dis(0, 100000000); // between 0 and 100 milliseconds
-    long long request_release_interval = dis(gen);
-    long long next_request_release_total = (long long)(*sec) * 1000000000LL + (long long)(*nano) + request_release_interval;
 
-        // Print starting message
-    cout << "Worker starting, " << "PID:" << getpid() << " PPID:" << getppid() << endl
-         << "Called With:" << endl
-         << "Interval: " << target_seconds << " seconds, " << target_nano << " nanoseconds" << endl
-         << "Request/Release Interval: " << request_release_interval << " nanoseconds" << endl;
+    // grant policy OSS runs, under avoidance every simulated process declares a claim
+    bool avoidance = (argc > 8) && string(argv[8]) == "avoid";
 
-    // setup distribution for request/release action
-    uniform_int_distribution<> action_dis(1, 100);
+    // -w pool: this process stays up and runs one simulated process after another for OSS
+    bool pooled = (argc > 10) && string(argv[9]) == "pool";
+    pool_member* member = pooled ? &slot_tab->pool[stoi(argv[10])] : nullptr;
+    int assignments_seen = 0;
 
-    // worker just staring message
-    cout << "Worker PID:" << getpid() << " PPID:" << getppid() << endl
-         << "SysClockS: " << *sec << " SysclockNano: " << *nano << " TermTimeS: " << end_seconds << " TermTimeNano: " << end_nano << endl
-         << "--Just Starting" << endl;
+    // seed and launch number of the simulated process, chosen by OSS so a run can be repeated
+    uint64_t seed = (argc > 11) ? stoull(argv[11]) : random_device{}(); // started by hand, no run seed
+    long long launch = (argc > 12) ? stoll(argv[12]) : -1;
+
+    // workload source: generated, generated and recorded, or replayed from a recording
+    string workload_mode = (argc > 14) ? argv[13] : "gen";
+    workload_recorder recorder;
+    workload_file script_file;
+    workload_file* script = nullptr;
+    workload_cursor cursor;
+    if (workload_mode == "record" && !recorder.open(argv[14])) {
+        cerr << "workload record file";
+        exit(1);
+    }
+    if (workload_mode == "replay") {
+        int bad_resource, bad_value;
+        if (!script_file.open(argv[14]) || (avoidance && script_file.bad_claim(geometry, bad_resource, bad_value) != -1)) {
+            cerr << "workload replay file";
+            exit(1);
+        }
+        script = &script_file;
+    }
 
-    // message-driven loop: block until OSS tells us to check the clock
-    MessageBuffer msg;
-    pid_t oss_pid = getppid();
+    // out-of-order requests: one release-and-reacquire message, or with oss -x a mass release, its ack and a second request
+    bool exchange = !((argc > 15) && string(argv[15]) == "split");
 
     while (true) {
-        // check if its time to terminate 
-        bool should_terminate = ((*sec > end_seconds) || (*sec == end_seconds && *nano >= end_nano));
-
-        if (should_terminate) {
-            // print terminating message
-            // TODO: add more deailated info
-            cout << "Worker PID:" << getpid() << " PPID:" << getppid() << endl
-                 << "SysClockS: " << *sec << " SysclockNano: " << *nano << " TermTimeS: " << end_seconds << " TermTimeNano: " << end_nano << endl
-                 << "--Terminating" << endl;
-            // send message to OSS indicating termination
+        if (member != nullptr) {
+            // wait to be handed the next simulated process, or for OSS to finish
+            while (member->assign_seq.load() == assignments_seen && !slot_tab->pool_shutdown.load()) {
+                futex_wait(&member->assign_seq, assignments_seen, nullptr);
+            }
+            if (slot_tab->pool_shutdown.load()) break;
+            assignments_seen = member->assign_seq.load();
+            pcb_index = member->pcb_index;
+            target_seconds = clock_sec(member->time_limit_ns);
+            target_nano = clock_nano(member->time_limit_ns);
+            seed = member->seed;
+            launch = member->launch;
+        }
+        gen.seed(seed);
+        recorder.start(launch);
+        if (script != nullptr) cursor.start(*script, launch);
+        worker_slot* my_slot = (pcb_index >= 0 && pcb_index < MAX_PROCESSES) ? &slot_tab->slots[pcb_index] : nullptr;
+
+        // under avoidance pick a random claim up front, at least one instance of something
+        for (int i = 0; i < MAX_RESOURCES; ++i) max_claim[i] = (i < geometry.resources) ? geometry.instances[i] : 0;
+        if (avoidance && script != nullptr) {
+            for (int i = 0; i < geometry.resources; ++i) {
+                const workload_op* o = cursor.take(WL_CLAIM);
+                max_claim[i] = o ? o->value : 0;
+            }
+        } else if (avoidance) {
+            int claimed = 0;
+            for (int i = 0; i < geometry.resources; ++i) {
+                uniform_int_distribution<> claim_dis(0, geometry.instances[i]);
+                max_claim[i] = claim_dis(gen);
+                claimed += max_claim[i];
+            }
+            if (claimed == 0) {
+                uniform_int_distribution<> class_dis(0, geometry.resources - 1);
+                max_claim[class_dis(gen)] = 1;
+            }
+            for (int i = 0; i < geometry.resources; ++i) recorder.append(WL_CLAIM, i, max_claim[i]);
+        }
+
+        // how many of each resource this process has
+        int held_resources[MAX_RESOURCES] = {0};
+        int latest_requested_resource_index = -1;
+
+        // calculate termination time
+        long long start_total = clock->now();
+        long long end_total = start_total + (long long)target_seconds * NSEC_PER_SEC + target_nano;
+        int end_seconds = clock_sec(end_total);
+        int end_nano = clock_nano(end_total);
+    
+        // get random time interval for when to request/release resources
+        uniform_int_distribution<> dis(1, 100000000); // between 0 and 100 milliseconds, never zero so time always moves forward
+        long long request_release_interval;
+        if (script != nullptr) {
+            const workload_op* o = cursor.take(WL_START);
+            request_release_interval = o ? o->value : 100000000;
+        } else {
+            request_release_interval = dis(gen);
+            recorder.append(WL_START, 0, request_release_interval);
+        }
+        long long next_request_release_total = start_total + cursor.gap(request_release_interval);
+
+            // Print starting message
+        cout << "Worker starting, " << "PID:" << getpid() << " PPID:" << getppid() << endl
+             << "Called With:" << endl
+             << "Interval: " << target_seconds << " seconds, " << target_nano << " nanoseconds" << endl
+             << "Request/Release Interval: " << request_release_interval << " nanoseconds" << endl;
+
+        MessageBuffer msg;
+
+        // tell OSS when we next need the clock: our next action or termination, whichever comes first
+        auto publish_deadline = [&]() {
+            if (my_slot == nullptr) return;
+            my_slot->deadline = min(next_request_release_total, end_total);
+            my_slot->state = SLOT_SLEEPING;
+            futex_bump(&slot_tab->doorbell);
+        };
+
+        // let OSS know a message is waiting for it
+        auto ring_oss = [&]() {
+            if (my_slot != nullptr) futex_bump(&slot_tab->doorbell);
+        };
+        // declare the claim before any request, OSS does not ack it
+        if (avoidance) {
             memset(&msg, 0, sizeof(msg));
             msg.mtype = getppid();
             msg.pid = getpid();
-            msg.process_running = 0; // indicate process is terminating
-            size_t msg_size = sizeof(MessageBuffer) - sizeof(long);
-            if (msgsnd(msgid, &msg, msg_size, 0) == -1) {
-                perror("worker msgsnd failed");
+            msg.process_running = 1;
+            msg.request_or_release = 1;
+            msg.declare_claim = 1;
+            for (int i = 0; i < geometry.resources; ++i) msg.resource_request[i] = max_claim[i];
+            if (!channel->send(pcb_index, msg)) {
+                perror("worker send failed");
                 exit(1);
             }
-            break; // exit loop and terminate
+            ring_oss();
         }
+        publish_deadline();
+
+        // setup distribution for request/release action
+        uniform_int_distribution<> action_dis(1, 100);
 
-        // check if its time to request/release resources
-        long long current_total = (long long)(*sec) * 1000000000LL + (long long)(*nano);
-        if (current_total >= next_request_release_total) {
-            if (all_of(held_resources, held_resources + MAX_RESOURCES, [](int i){ return i >= MAX_INSTANCES; })) {
-                // holding max of all resources skip request
-                continue;
+        // worker just staring message
+        cout << "Worker PID:" << getpid() << " PPID:" << getppid() << endl
+             << "SysClockS: " << clock_sec(start_total) << " SysclockNano: " << clock_nano(start_total) << " TermTimeS: " << end_seconds << " TermTimeNano: " << end_nano << endl
+             << "--Just Starting" << endl;
+
+        // message-driven loop: block until OSS tells us to check the clock
+        pid_t oss_pid = getppid();
+
+        while (true) {
+            // sleep until OSS moves the clock past our deadline instead of spinning on it
+            if (my_slot != nullptr) {
+                int seq = my_slot->wake_seq.load();
+                if (clock->now() < min(next_request_release_total, end_total)) {
+                    futex_wait(&my_slot->wake_seq, seq, nullptr);
+                    continue;
+                }
+                my_slot->state = SLOT_BUSY;
+            }
+
+            // one snapshot of the clock for this pass
+            long long now = clock->now();
+
+            // check if its time to terminate 
+            bool should_terminate = (now >= end_total);
+
+            if (should_terminate) {
+                // print terminating message
+                // TODO: add more deailated info
+                cout << "Worker PID:" << getpid() << " PPID:" << getppid() << endl
+                     << "SysClockS: " << clock_sec(now) << " SysclockNano: " << clock_nano(now) << " TermTimeS: " << end_seconds << " TermTimeNano: " << end_nano << endl
+                     << "--Terminating" << endl;
+                // send message to OSS indicating termination
+                memset(&msg, 0, sizeof(msg));
+                msg.mtype = getppid();
+                msg.pid = getpid();
+                msg.process_running = 0; // indicate process is terminating
+                if (!channel->send(pcb_index, msg)) {
+                    perror("worker send failed");
+                    exit(1);
+                }
+                ring_oss();
+                break; // exit loop and terminate
             }
-            // decide whether to request or release a resource 60% request, 40% release
-            int action_roll = action_dis(gen);
-            if (action_roll <= 60) {
-                // request resource
-                int resource_index = get_resource_request(held_resources);
-                // determine how much to request
-                int max_amount = MAX_INSTANCES - held_resources[resource_index];
-                uniform_int_distribution<> amount_dis(1, max_amount);
-                int amount = amount_dis(gen);
-
-                // out of order request
-                if (resource_index <= latest_requested_resource_index) {
-                    cout << "Worker PID:" << getpid() << " making out-of-order request for resource " << resource_index << endl;
-                    int release_request[MAX_RESOURCES] = {0};
-                    for (int i = resource_index; i < MAX_RESOURCES; i++) {
-                        if (held_resources[i] > 0) {
-                            release_request[i] = held_resources[i];
-                            held_resources[i] = 0;
-                            cout << "Worker PID:" << getpid() << " releasing " << release_request[i] << " instances of resource " << i << " to make out-of-order request" << endl;
-                        }
-                    }
-                    // release higher-indexed resources
-                    memset(&msg, 0, sizeof(msg));
-                    msg.mtype = getppid();
-                    msg.pid = getpid();
-                    msg.process_running = 1; // indicate process is running
-                    msg.request_or_release = 0; // indicate release
-                    msg.mass_release = 1; // indicate mass release
 
-                    for (int i = 0; i < MAX_RESOURCES; ++i) {
-                        msg.resource_release[i] = release_request[i];
+            // check if its time to request/release resources
+            if (now >= next_request_release_total) {
+                bool holding_max = true;
+                for (int i = 0; i < geometry.resources; i++) {
+                    if (held_resources[i] < max_claim[i]) holding_max = false;
+                }
+                if (holding_max && script == nullptr) {
+                    // holding max of all resources skip request, a replayed stream has this recorded as idle
+                    recorder.append(WL_IDLE, 0, 0);
+                    next_request_release_total = clock->now() + cursor.gap(request_release_interval); // schedule next request/release time
+                    publish_deadline();
+                    continue;
+                }
+                // decide whether to request or release a resource 60% request, 40% release
+                // or take the next recorded choice when replaying
+                int action;
+                int resource_index = 0;
+                int amount = 0;
+                if (script != nullptr) {
+                    const workload_op* o = cursor.take_action();
+                    if (o == nullptr) {
+                        // recorded stream is over, sit out the rest of the time limit
+                        next_request_release_total = end_total;
+                        publish_deadline();
+                        continue;
                     }
-                    size_t msg_size = sizeof(MessageBuffer) - sizeof(long);
-                    if (msgsnd(msgid, &msg, msg_size, 0) == -1) {
-                        perror("worker msgsnd failed");
-                        exit(1);
+                    action = o->op;
+                    resource_index = o->resource;
+                    amount = o->value;
+                    if (action == WL_TERMINATE) {
+                        end_total = now;
+                        continue;
                     }
-                    // wait for message from OSS acknowledging release
-                    size_t rcv_size = sizeof(MessageBuffer) - sizeof(long);
-                    if (msgrcv(msgid, &msg, rcv_size, getpid(), 0) == -1) {
-                        perror("worker msgrcv failed");
-                        exit(1);
+                    workload_fit(action, resource_index, amount, held_resources, max_claim, geometry.resources);
+                } else if (action_dis(gen) <= 60) {
+                    action = WL_REQUEST;
+                    resource_index = get_resource_request(held_resources);
+                    // determine how much to request
+                    int max_amount = max_claim[resource_index] - held_resources[resource_index];
+                    uniform_int_distribution<> amount_dis(1, max_amount);
+                    amount = amount_dis(gen);
+                } else if (latest_requested_resource_index == -1 || all_of(held_resources, held_resources + geometry.resources, [](int i){ return i == 0; })) {
+                    action = WL_IDLE;
+                } else {
+                    action = WL_RELEASE;
+                    resource_index = get_resource_release(held_resources);
+                    // determine how much to release
+                    uniform_int_distribution<> amount_dis(1, held_resources[resource_index]);
+                    amount = amount_dis(gen);
+                }
+                recorder.append(action, resource_index, amount);
+
+                if (action == WL_REQUEST) {
+                    // out of order request
+                    if (resource_index <= latest_requested_resource_index) {
+                        cout << "Worker PID:" << getpid() << " making out-of-order request for resource " << resource_index << endl;
+                        int release_request[MAX_RESOURCES] = {0};
+                        for (int i = resource_index; i < geometry.resources; i++) {
+                            if (held_resources[i] > 0) {
+                                release_request[i] = held_resources[i];
+                                held_resources[i] = 0;
+                                cout << "Worker PID:" << getpid() << " releasing " << release_request[i] << " instances of resource " << i << " to make out-of-order request" << endl;
+                            }
+                        }
+                        int reacquire[MAX_RESOURCES] = {0};
+                        for (int i = 0; i < geometry.resources; ++i) reacquire[i] = release_request[i];
+                        reacquire[resource_index] += amount;
+                        if (exchange) {
+                            // release higher-indexed resources and request them back plus the new amount in one message
+                            memset(&msg, 0, sizeof(msg));
+                            msg.mtype = getppid();
+                            msg.pid = getpid();
+                            msg.process_running = 1; // indicate process is running
+                            msg.request_or_release = 1; // indicate request
+                            msg.exchange = 1; // the release goes back first
+                            for (int i = 0; i < geometry.resources; ++i) {
+                                msg.resource_release[i] = release_request[i];
+                                msg.resource_request[i] = reacquire[i];
+                            }
+                            now = clock->now();
+                            cout << "Worker PID:" << getpid() << " requesting back released resources plus " << amount << " instances of resource " << resource_index << " in the same message at SysClockS: " << clock_sec(now) << " SysclockNano: " << clock_nano(now) << endl;
+                            if (!channel->send(pcb_index, msg)) {
+                                perror("worker send failed");
+                                exit(1);
+                            }
+                            ring_oss();
+                            // wait for message from OSS acknowledging the request
+                            if (!channel->wait_ack(pcb_index, msg)) {
+                                perror("worker receive failed");
+                                exit(1);
+                            }
+                        } else {
+                            // release higher-indexed resources
+                            memset(&msg, 0, sizeof(msg));
+                            msg.mtype = getppid();
+                            msg.pid = getpid();
+                            msg.process_running = 1; // indicate process is running
+                            msg.request_or_release = 0; // indicate release
+                            msg.mass_release = 1; // indicate mass release
+
+                            for (int i = 0; i < geometry.resources; ++i) {
+                                msg.resource_release[i] = release_request[i];
+                            }
+                            if (!channel->send(pcb_index, msg)) {
+                                perror("worker send failed");
+                                exit(1);
+                            }
+                            ring_oss();
+                            // wait for message from OSS acknowledging release
+                            if (!channel->wait_ack(pcb_index, msg)) {
+                                perror("worker receive failed");
+                                exit(1);
+                            }
+                            // now request back the released resources plus the new request
+                            memset(&msg, 0, sizeof(msg));
+                            msg.mtype = getppid();
+                            msg.pid = getpid();
+                            msg.process_running = 1; // indicate process is running
+                            msg.request_or_release = 1; // indicate request
+                            for (int i = 0; i < geometry.resources; ++i) {
+                                msg.resource_request[i] = reacquire[i];
+                            }
+
+                            now = clock->now();
+                            cout << "Worker PID:" << getpid() << " requesting back released resources plus " << amount << " instances of resource " << resource_index << " at SysClockS: " << clock_sec(now) << " SysclockNano: " << clock_nano(now) << endl;
+                            if (!channel->send(pcb_index, msg)) {
+                                perror("worker send failed");
+                                exit(1);
+                            }
+                            ring_oss();
+                            // wait for message from OSS acknowledging request
+                            if (!channel->wait_ack(pcb_index, msg)) {
+                                perror("worker receive failed");
+                                exit(1);
+                            }
+                        }
+                        // update resources
+                        for (int i = 0; i < geometry.resources; ++i) {
+                            held_resources[i] += release_request[i];
+                        }
+                        held_resources[resource_index] += amount;
+                        // update latest requested resource index
+                        latest_requested_resource_index = -1;
+                        for (int i = geometry.resources - 1; i >= 0; --i) {
+                            if (held_resources[i] > 0) {
+                                latest_requested_resource_index = i;
+                                break;
+                            }
+                        }
+                        next_request_release_total = clock->now() + cursor.gap(request_release_interval); // schedule next request/release time
+                        publish_deadline();
+                        continue;
                     }
-                    // now request back the released resources plus the new request
+
+                    cout << "Worker PID:" << getpid() << " requesting " << amount << " instances of resource " << resource_index << " at SysClockS: " << clock_sec(now) << " SysclockNano: " << clock_nano(now) << endl;
+                    // send message to OSS requesting resource
                     memset(&msg, 0, sizeof(msg));
                     msg.mtype = getppid();
                     msg.pid = getpid();
                     msg.process_running = 1; // indicate process is running
                     msg.request_or_release = 1; // indicate request
-                    for (int i = 0; i < MAX_RESOURCES; ++i) {
-                        if (release_request[i] > 0) {
-                            msg.resource_request[i] = release_request[i];
-                        }
-                    }
-                    msg.resource_request[resource_index] += amount;
-
-                    cout << "Worker PID:" << getpid() << " requesting back released resources plus " << amount << " instances of resource " << resource_index << " at SysClockS: " << *sec << " SysclockNano: " << *nano << endl;
-                    if (msgsnd(msgid, &msg, msg_size, 0) == -1) {
-                        perror("worker msgsnd failed");
+                    msg.resource_request[resource_index] = amount;
+                    if (!channel->send(pcb_index, msg)) {
+                        perror("worker send failed");
                         exit(1);
                     }
+                    ring_oss();
                     // wait for message from OSS acknowledging request
-                    if (msgrcv(msgid, &msg, rcv_size, getpid(), 0) == -1) {
-                        perror("worker msgrcv failed");
+                    if (!channel->wait_ack(pcb_index, msg)) {
+                        perror("worker receive failed");
                         exit(1);
                     }
-                    // update resources
-                    for (int i = 0; i < MAX_RESOURCES; ++i) {
-                        held_resources[i] += release_request[i];
-                    }
-                    held_resources[resource_index] += amount;
-                    // update latest requested resource index
-                    latest_requested_resource_index = -1;
-                    for (int i = MAX_RESOURCES - 1; i >= 0; --i) {
-                        if (held_resources[i] > 0) {
-                            latest_requested_resource_index = i;
-                            break;
-                        }
-                    }
-                    next_request_release_total = (long long)(*sec) * 1000000000LL + (long long)(*nano) + request_release_interval; // schedule next request/release time
-                    continue;
-                }
-
-                cout << "Worker PID:" << getpid() << " requesting " << amount << " instances of resource " << resource_index << " at SysClockS: " << *sec << " SysclockNano: " << *nano << endl;
-                // send message to OSS requesting resource
-                memset(&msg, 0, sizeof(msg));
-                msg.mtype = getppid();
-                msg.pid = getpid();
-                msg.process_running = 1; // indicate process is running
-                msg.request_or_release = 1; // indicate request
-                msg.resource_request[resource_index] = amount;
-                size_t msg_size = sizeof(MessageBuffer) - sizeof(long);
-                if (msgsnd(msgid, &msg, msg_size, 0) == -1) {
-                    perror("worker msgsnd failed");
-                    exit(1);
-                }
-                // wait for message from OSS acknowledging request
-                size_t rcv_size = sizeof(MessageBuffer) - sizeof(long);
-                if (msgrcv(msgid, &msg, rcv_size, getpid(), 0) == -1) {
-                    perror("worker msgrcv failed");
-                    exit(1);
-                }
 
-                // update held resources
-                latest_requested_resource_index = resource_index;
-                held_resources[resource_index] += amount;
-                next_request_release_total = (long long)(*sec) * 1000000000LL + (long long)(*nano) + request_release_interval; // schedule next request/release time
-            } else {
-                if (latest_requested_resource_index == -1 || all_of(held_resources, held_resources + MAX_RESOURCES, [](int i){ return i == 0; })) {
+                    // update held resources
+                    latest_requested_resource_index = resource_index;
+                    held_resources[resource_index] += amount;
+                    next_request_release_total = clock->now() + cursor.gap(request_release_interval); // schedule next request/release time
+                    publish_deadline();
+                } else if (action == WL_IDLE) {
                     // no resources held, skip release
-                    next_request_release_total = (long long)(*sec) * 1000000000LL + (long long)(*nano) + request_release_interval; // schedule next request/release time
-                    continue;
-                }
-                // release resource
-                // choose resource to release
-                int resource_index = get_resource_release(held_resources);
-                // determine how much to release
-                int held_amount = held_resources[resource_index];
-                uniform_int_distribution<> amount_dis(1, held_amount);
-                int amount = amount_dis(gen);
-                cout << "Worker PID:" << getpid() << " releasing " << amount << " instances of resource " << resource_index << " at SysClockS: " << *sec << " SysclockNano: " << *nano << endl;
-                // send message to OSS releasing resource
-                memset(&msg, 0, sizeof(msg));
-                msg.mtype = getppid();
-                msg.pid = getpid();
-                msg.process_running = 1; // indicate process is running
-                msg.request_or_release = 0; // indicate release
-                msg.resource_release[resource_index] = amount;
-                size_t msg_size = sizeof(MessageBuffer) - sizeof(long);
-                if (msgsnd(msgid, &msg, msg_size, 0) == -1) cerr << "msgsnd" << endl;
-                // wait for message from OSS acknowledging release
-                size_t rcv_size = sizeof(MessageBuffer) - sizeof(long);
-                if (msgrcv(msgid, &msg, rcv_size, getpid(), 0) == -1) {
-                    cerr << "msgrcv" << endl;
-                }
+                    next_request_release_total = clock->now() + cursor.gap(request_release_interval); // schedule next request/release time
+                    publish_deadline();
+                } else {
+                    // release resource
+                    cout << "Worker PID:" << getpid() << " releasing " << amount << " instances of resource " << resource_index << " at SysClockS: " << clock_sec(now) << " SysclockNano: " << clock_nano(now) << endl;
+                    // send message to OSS releasing resource
+                    memset(&msg, 0, sizeof(msg));
+                    msg.mtype = getppid();
+                    msg.pid = getpid();
+                    msg.process_running = 1; // indicate process is running
+                    msg.request_or_release = 0; // indicate release
+                    msg.resource_release[resource_index] = amount;
+                    if (!channel->send(pcb_index, msg)) cerr << "msgsnd" << endl;
+                    ring_oss();
+                    // wait for message from OSS acknowledging release
+                    if (!channel->wait_ack(pcb_index, msg)) {
+                        cerr << "msgrcv" << endl;
+                    }
 
-                // update held resources
-                held_resources[resource_index] -= amount;
-                if (resource_index == latest_requested_resource_index && held_resources[resource_index] == 0) {
+                    // update held resources
+                    held_resources[resource_index] -= amount;
+                    if (resource_index == latest_requested_resource_index && held_resources[resource_index] == 0) {
 
-                    // released all instances of latest requested resource, need to update latest_requested_resource_index
-                    latest_requested_resource_index = -1;
-                    for (int i = MAX_RESOURCES - 1; i >= 0; --i) {
-                        if (held_resources[i] > 0) {
-                            latest_requested_resource_index = i;
-                            break;
+                        // released all instances of latest requested resource, need to update latest_requested_resource_index
+                        latest_requested_resource_index = -1;
+                        for (int i = geometry.resources - 1; i >= 0; --i) {
+                            if (held_resources[i] > 0) {
+                                latest_requested_resource_index = i;
+                                break;
+                            }
                         }
                     }
+                    next_request_release_total = clock->now() + cursor.gap(request_release_interval); // schedule next request/release time
+                    publish_deadline();
                 }
-                next_request_release_total = (long long)(*sec) * 1000000000LL + (long long)(*nano) + request_release_interval; // schedule next request/release time
             }
         }
+        if (member == nullptr) break;
     }
+    delete channel;
+    shmdt(slot_tab);
     shmdt(clock);
     return 0;
 }
\ No newline at end of file
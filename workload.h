@@ -0,0 +1,253 @@
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "resources.h"
+
+// workload streams: recorded by oss -C, written by ossgen, run by oss -L
+//
+// every simulated process is numbered by launch order and its stream is the sequence of choices
+// it makes: its request/release interval, its claim under avoidance, and for each action whether it
+// requests, releases or does nothing, of which class and how many
+// a worker's held state only changes through its own choices, so replaying a stream reproduces the
+// same messages whatever the scheduler does, only their timing changes
+// a script can also time its actions itself (WL_WAIT) and end the process early (WL_TERMINATE)
+//
+// while recording, workers append raw records tagged with their launch number; once the run is
+// over OSS sorts them into one stream per process behind an index
+#define WORKLOAD_MAGIC "OSSWKLD1"
+
+// stream operations
+#define WL_START 0   // value: request/release interval in ns, after the claims
+#define WL_CLAIM 1   // resource, value: declared maximum claim
+#define WL_REQUEST 2 // resource, value: amount
+#define WL_RELEASE 3 // resource, value: amount
+#define WL_IDLE 4    // an action that sent nothing
+#define WL_WAIT 5    // value: ns until the next action, instead of the interval; consecutive waits add up
+#define WL_TERMINATE 6 // the process ends here
+
+struct workload_op {
+    uint8_t op;
+    uint8_t resource;
+    uint16_t pad;
+    int32_t value;
+};
+
+// as appended during recording
+struct workload_raw {
+    int32_t launch;
+    workload_op o;
+};
+
+// compacted file: header, streams + 1 op offsets, then the ops
+struct workload_header {
+    char magic[8];
+    int32_t resources;
+    int32_t avoidance;
+    int64_t streams;
+    int64_t ops;
+};
+
+static_assert(sizeof(workload_op) == 8, "workload ops must stay compact");
+
+// splitmix64, spreads one run seed into independent per-process seeds
+static inline uint64_t derive_seed(uint64_t run_seed, long long launch) {
+    uint64_t z = run_seed + 0x9e3779b97f4a7c15ULL * (uint64_t)(launch + 1);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// appends one process's choices to the raw record file, each record is a single O_APPEND write
+// so records from concurrent workers never interleave
+class workload_recorder {
+    int fd = -1;
+    int32_t launch = -1;
+public:
+    ~workload_recorder() { if (fd != -1) ::close(fd); }
+
+    bool open(const std::string &path) {
+        fd = ::open(path.c_str(), O_WRONLY | O_APPEND);
+        return fd != -1;
+    }
+    bool is_open() const { return fd != -1; }
+    void start(long long launch_number) { launch = (int32_t) launch_number; }
+
+    void append(int op, int resource, long long value) {
+        if (fd == -1) return;
+        workload_raw r;
+        memset(&r, 0, sizeof(r));
+        r.launch = launch;
+        r.o.op = (uint8_t) op;
+        r.o.resource = (uint8_t) resource;
+        r.o.value = (int32_t) value;
+        if (write(fd, &r, sizeof(r)) != (ssize_t) sizeof(r)) {} // a short stream replays as an early finish
+    }
+};
+
+// create or truncate path for a recording
+static inline bool workload_record_begin(const std::string &path) {
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) return false;
+    ::close(fd);
+    return true;
+}
+
+// write ops, streams + 1 offsets into it, as a runnable file at path
+static inline bool workload_write(const std::string &path, int resources, bool avoidance,
+                                  const std::vector<int64_t> &offsets, const std::vector<workload_op> &ops) {
+    workload_header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, WORKLOAD_MAGIC, sizeof(h.magic));
+    h.resources = resources;
+    h.avoidance = avoidance;
+    h.streams = (int64_t) offsets.size() - 1;
+    h.ops = (int64_t) ops.size();
+
+    std::string tmp = path + ".tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) return false;
+    bool ok = write(fd, &h, sizeof(h)) == (ssize_t) sizeof(h)
+           && write(fd, offsets.data(), offsets.size() * sizeof(int64_t)) == (ssize_t) (offsets.size() * sizeof(int64_t))
+           && (ops.empty() || write(fd, ops.data(), ops.size() * sizeof(workload_op)) == (ssize_t) (ops.size() * sizeof(workload_op)));
+    ::close(fd);
+    return ok && rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+// sort the raw records at path into per-process streams and rewrite it as a replayable file
+static inline bool workload_record_finish(const std::string &path, const resource_geometry &g, bool avoidance) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd == -1) return false;
+    std::vector<workload_raw> raw;
+    workload_raw r;
+    while (read(fd, &r, sizeof(r)) == (ssize_t) sizeof(r)) {
+        if (r.launch >= 0) raw.push_back(r); // a worker started by hand has no launch number
+    }
+    ::close(fd);
+    std::stable_sort(raw.begin(), raw.end(), [](const workload_raw &a, const workload_raw &b) { return a.launch < b.launch; });
+
+    long long streams = raw.empty() ? 0 : raw.back().launch + 1;
+    std::vector<int64_t> offsets(streams + 1, 0);
+    for (const workload_raw &x : raw) offsets[x.launch + 1]++;
+    for (long long i = 0; i < streams; ++i) offsets[i + 1] += offsets[i];
+    std::vector<workload_op> ops;
+    ops.reserve(raw.size());
+    for (const workload_raw &x : raw) ops.push_back(x.o);
+    return workload_write(path, g.resources, avoidance, offsets, ops);
+}
+
+// a compacted recording, memory-mapped read-only
+class workload_file {
+    void *base = MAP_FAILED;
+    size_t bytes = 0;
+    const workload_header *h = nullptr;
+    const int64_t *offsets = nullptr;
+    const workload_op *ops = nullptr;
+public:
+    ~workload_file() { if (base != MAP_FAILED) munmap(base, bytes); }
+
+    bool open(const std::string &path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd == -1) return false;
+        struct stat st;
+        if (fstat(fd, &st) == -1 || (size_t) st.st_size < sizeof(workload_header)) {
+            ::close(fd);
+            return false;
+        }
+        bytes = st.st_size;
+        base = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED) return false;
+        h = (const workload_header*) base;
+        if (memcmp(h->magic, WORKLOAD_MAGIC, sizeof(h->magic)) != 0 || h->streams < 0 || h->ops < 0) return false;
+        if (sizeof(workload_header) + (h->streams + 1) * sizeof(int64_t) + h->ops * sizeof(workload_op) > bytes) return false;
+        offsets = (const int64_t*) (h + 1);
+        ops = (const workload_op*) (offsets + h->streams + 1);
+        return true;
+    }
+
+    int resources() const { return h->resources; }
+    bool avoidance() const { return h->avoidance != 0; }
+    long long streams() const { return h->streams; }
+
+    // index of the first stream whose leading claims do not fit g, -1 if every one does: a claim
+    // out of order, negative or above its class's instances; bad_resource and bad_value say which
+    long long bad_claim(const resource_geometry &g, int &bad_resource, int &bad_value) const {
+        for (long long launch = 0; launch < h->streams; ++launch) {
+            const workload_op *o = ops + offsets[launch];
+            const workload_op *end = ops + offsets[launch + 1];
+            for (int i = 0; i < g.resources && o != end && o->op == WL_CLAIM; ++i, ++o) {
+                if (o->resource != i || o->value < 0 || o->value > g.instances[i]) {
+                    bad_resource = o->resource;
+                    bad_value = o->value;
+                    return launch;
+                }
+            }
+        }
+        return -1;
+    }
+
+    // first op of process launch's stream and how many it has, empty past the recorded processes
+    const workload_op *stream(long long launch, size_t &count) const {
+        if (launch < 0 || launch >= h->streams) {
+            count = 0;
+            return ops;
+        }
+        count = (size_t) (offsets[launch + 1] - offsets[launch]);
+        return ops + offsets[launch];
+    }
+};
+
+// one process's recorded stream, consumed in order
+struct workload_cursor {
+    const workload_op *next = nullptr;
+    const workload_op *end = nullptr;
+
+    void start(const workload_file &f, long long launch) {
+        size_t n;
+        next = f.stream(launch, n);
+        end = next + n;
+    }
+    bool done() const { return next == end; }
+    // the next op if it is one of kind, else nullptr
+    const workload_op *take(int kind) {
+        if (next == end || next->op != kind) return nullptr;
+        return next++;
+    }
+    // the next request, release, idle or terminate, nullptr once the stream is over
+    const workload_op *take_action() {
+        while (next != end && next->op == WL_WAIT) next++;
+        if (next == end || next->op < WL_REQUEST) return nullptr;
+        return next++;
+    }
+    // ns until the next action: what the script's waits add up to, else interval
+    long long gap(long long interval) {
+        if (next == end || next->op != WL_WAIT) return interval;
+        long long total = 0;
+        while (next != end && next->op == WL_WAIT) total += (next++)->value;
+        return total > 0 ? total : 1; // time must still move forward
+    }
+};
+
+// make a scripted choice valid for what the process holds: requests are cut to its claim,
+// releases to what it has, and one left with nothing to do becomes an idle action
+static inline void workload_fit(int &action, int &resource, int &amount, const int *held, const int *max_claim, int resources) {
+    if (action != WL_REQUEST && action != WL_RELEASE) return;
+    if (resource < 0 || resource >= resources) {
+        action = WL_IDLE;
+        return;
+    }
+    int room = (action == WL_REQUEST) ? max_claim[resource] - held[resource] : held[resource];
+    if (amount > room) amount = room;
+    if (amount <= 0) action = WL_IDLE;
+}
+
+#endif